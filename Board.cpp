@@ -1,12 +1,37 @@
 #include "Board.h"
+#include "EditQueue.h"
+#include "TileScheduler.h"
 #include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <utility>
 #include <list>
+#include <vector>
 
 namespace Life {
+	// neighbor count masks of the linear (XOR) rules
+	static const unsigned int ALL_COUNTS = 0x1FF;
+	static const unsigned int ODD_COUNTS = 0x0AA;
+	static const unsigned int EVEN_COUNTS = 0x155;
+
+	// step() works on tiles of up to TILE_ROWS rows and TILE_WORDS words,
+	// a tile with more than SPLIT_POPULATION live cells is halved down to MIN_TILE_ROWS * 1 word
+	static const int TILE_ROWS = 256;
+	static const int TILE_WORDS = 4;
+	static const int MIN_TILE_ROWS = 16;
+	static const long SPLIT_POPULATION = 64;
+	// smaller boards are stepped on the calling thread
+	static const long PARALLEL_CELLS = 1L << 16;
+	// the event engine follows edits of up to 1 / EDIT_REBUILD_SHARE of the cells,
+	// and rebuilds its counts after larger ones
+	static const long EDIT_REBUILD_SHARE = 16;
+
+	// a growing board extends a side by at least GROWTH_CHUNK cells (or half its size),
+	// a shrinking one checks every SHRINK_INTERVAL generations and keeps GROWTH_CHUNK / 2 dead cells around
+	static const int GROWTH_CHUNK = 64;
+	static const int SHRINK_INTERVAL = 64;
+
 	using std::max;
 	using std::min;
 	using std::ostream;
@@ -14,6 +39,8 @@ namespace Life {
 	using std::string;
 	using std::pair;
 	using std::list;
+	using std::vector;
+	using ::Matrix::OutOfBounds;
 
 	/**
 	 * @brief builds a square board
@@ -29,100 +56,744 @@ namespace Life {
 	 * @param w width
 	 **/
 	Board::Board (const int h, const int w, const unsigned int survival,
-	              const unsigned int birth) : board (h, w), survival (survival), birth (birth) {
+	              const unsigned int birth) : board (h, w), storage (nullptr), survival (survival), birth (birth), growing (false), shrinking (false), top (0), left (0),
+		untilShrink (SHRINK_INTERVAL), engine (TILED), stamp (0), eventsValid (false), layout (ROW_MAJOR), tilesStale (true),
+		rowsStale (false), edits (nullptr), scheduler (nullptr), countsValid (false) {
+	}
+
+	/**
+	 * @brief copies a board - a fork: the cells are shared band by band and copied on write,
+	 * so a copy costs O(bands) and each copy only pays for the bands it changes.
+	 * the caches (summed-area table, event engine state, spare buffer) are rebuilt when needed,
+	 * and the copy doesn't take the edit queue (it does run on the same scheduler)
+	 * @param b the board to copy
+	 **/
+	Board::Board (const Board &b) : board (b.getCells()), storage (b.storage), survival (b.survival), birth (b.birth),
+		growing (b.growing), shrinking (b.shrinking), top (b.top), left (b.left), untilShrink (b.untilShrink),
+		engine (b.engine), stamp (0), eventsValid (false), layout (b.layout), tilesStale (true), rowsStale (false),
+		edits (nullptr), scheduler (b.scheduler), countsValid (false) {
 	}
 
 	Board::~Board() {
 	}
 
+	/**
+	 * @brief copies a board (see the copy constructor)
+	 * @param b the board to copy
+	 * @return *this
+	 **/
+	Board &Board::operator= (const Board &b) {
+		if (this == &b) {
+			return *this;
+		}
+		board = b.getCells();
+		rowsStale = false;
+		if (storage != b.storage) {
+			spare = Matrix<bool>();
+		}
+		storage = b.storage;
+		survival = b.survival;
+		birth = b.birth;
+		growing = b.growing;
+		shrinking = b.shrinking;
+		top = b.top;
+		left = b.left;
+		untilShrink = b.untilShrink;
+		engine = b.engine;
+		layout = b.layout;
+		scheduler = b.scheduler;
+		changed();
+		return *this;
+	}
+
 	/**
 	 * @brief const cell access
+	 * (cells outside a growing board are dead)
 	 * @param r row
 	 * @param c column
 	 * @return cell at r,c (const)
 	 **/
-	const bool &Board::operator() (const int r, const int c) const {
-		return board (r, c);
+	bool Board::operator() (const int r, const int c) const {
+		const bool outside = r < top || r >= top + getHeight() || c < left || c >= left + getWidth();
+		if (growing && outside) {
+			return false;
+		}
+		if (rowsStale) {
+			// read the tiles rather than bring all the rows up to date
+			if (outside) {
+				throw OutOfBounds();
+			}
+			return tiles (r - top, c - left);
+		}
+		return board (r - top, c - left);
 	}
 
 	/**
-	 * @brief cell access
+	 * @brief cell access - a lookup until the cell is assigned (see reference)
 	 * @param r row
 	 * @param c column
-	 * @return cell at r,c
+	 * @return reference to the cell at r,c
 	 **/
-	bool &Board::operator() (const int r, const int c) {
-		return board (r, c);
+	Board::reference Board::operator() (const int r, const int c) {
+		return reference (this, r, c);
 	}
 
 	/**
 	 * @brief const cell access
 	 * @param p pair of (row, column)
-	 * @return cell at row,column (const reference)
+	 * @return cell at row,column (const)
 	 **/
-	const bool &Board::operator() (const pair<int, int> &p) const {
+	bool Board::operator() (const pair<int, int> &p) const {
 		return (*this) (p.first, p.second);
 	}
 
 	/**
 	 * @brief cell access
 	 * @param p pair of (row,column)
-	 * @return cell at row,column
+	 * @return reference to the cell at row,column
 	 **/
-	bool &Board::operator() (const pair<int, int> &p) {
+	Board::reference Board::operator() (const pair<int, int> &p) {
 		return (*this) (p.first, p.second);
 	}
 
+	/**
+	 * @brief reads the cell, leaving the board (and its caches) as it is
+	 * @return the cell
+	 **/
+	Board::reference::operator bool() const {
+		return static_cast<const Board &> (*b) (cell);
+	}
+
+	/**
+	 * @brief sets or clears the cell (extending a growing board to it)
+	 * @param value the new state
+	 * @return *this
+	 **/
+	Board::reference &Board::reference::operator= (const bool value) {
+		b->update (&cell, 1, value ? SET : CLEAR);
+		return *this;
+	}
+
+	/**
+	 * @brief copies the state of another cell
+	 * @param r the cell
+	 * @return *this
+	 **/
+	Board::reference &Board::reference::operator= (const reference &r) {
+		return *this = bool (r);
+	}
+
+	/**
+	 * @brief toggles the cell
+	 * @return *this
+	 **/
+	Board::reference &Board::reference::flip() {
+		b->update (&cell, 1, TOGGLE);
+		return *this;
+	}
+
 	/**
 	 * @brief performs a single step
+	 * the board is cut into tiles run by the board's TileScheduler (see setScheduler):
+	 * tiles without live cells around them are skipped (unless the rule gives birth on 0 neighbors),
+	 * busy tiles are split so idle workers can steal the parts
 	 * @return a reference to the board after the step
 	 **/
 	Board &Board::step() {
-		Matrix<bool> result (board);
-		for (int i = 0; i < board.getHeight(); i++) {
-			for (int j = 0; j < board.getWidth(); j++) {
-				int neighbors = countNeighbors (i, j);
-				unsigned int mask = 1;
-				while (neighbors > 0) {
-					mask *= 2;
-					neighbors--;
-				}
-				if (board (i, j)) {
-					if ( (mask & survival) == 0) {
-						result (i, j) = false;
-					}
-				} else {
-					if ( (mask & birth) != 0) {
-						result (i, j) = true;
+		if (edits != nullptr) {
+			edits->apply (*this);
+		}
+		if (layout == MORTON && engine == TILED && !growing) {
+			stepMorton();
+			return *this;
+		}
+		sync();
+		if (growing) {
+			grow();
+		}
+		if (engine == EVENTS) {
+			stepEvents();
+			// only the summed-area table is stale, the event state is up to date
+			countsValid = false;
+			return *this;
+		}
+		const int height = getHeight();
+		const int stride = board.getStride();
+		// boards on page storage swap between two buffers (that stay where they were first touched)
+		const bool reuse = storage != nullptr && spare.getHeight() == height && spare.getWidth() == getWidth();
+		Matrix<bool> next (reuse ? std::move (spare) : Matrix<bool> (height, getWidth(),
+		                   storage != nullptr ? storage : ::Matrix::currentResource()));
+		// the workers write rows of the same bands, which must not be copied on write under them
+		next.unshare();
+		vector<Tile> tiles;
+		for (int r = 0; r < height; r += TILE_ROWS) {
+			for (int w = 0; w < stride; w += TILE_WORDS) {
+				tiles.push_back (Tile { r, min (TILE_ROWS, height - r), w, min (TILE_WORDS, stride - w) });
+			}
+		}
+		const bool skipEmpty = (birth & 1) == 0;
+		TileScheduler::Body body = [this, &next, skipEmpty, reuse] (const Tile & tile, vector<Tile> &parts) -> long {
+			long live = activity (tile);
+			if (live == 0 && skipEmpty) {
+				if (reuse) {
+					// the buffer holds an older generation
+					for (int i = tile.row; i < tile.row + tile.height; i++) {
+						std::fill (next.rowWords (i) + tile.word, next.rowWords (i) + tile.word + tile.words, 0);
 					}
 				}
+				return 0;
+			}
+			if (live > SPLIT_POPULATION) {
+				// halve the longer side
+				if (tile.words > 1 && tile.words * Matrix<bool>::wordBits >= tile.height) {
+					int half = tile.words / 2;
+					parts.push_back (Tile { tile.row, tile.height, tile.word, half });
+					parts.push_back (Tile { tile.row, tile.height, tile.word + half, tile.words - half });
+					return 0;
+				}
+				if (tile.height >= 2 * MIN_TILE_ROWS) {
+					int half = tile.height / 2;
+					parts.push_back (Tile { tile.row, half, tile.word, tile.words });
+					parts.push_back (Tile { tile.row + half, tile.height - half, tile.word, tile.words });
+					return 0;
+				}
 			}
+			stepTile (next, tile);
+			return long (tile.height) * tile.words * Matrix<bool>::wordBits;
+		};
+		if (long (height) * getWidth() < PARALLEL_CELLS) {
+			TileScheduler::serial (tiles, body);
+		} else {
+			getScheduler().run (tiles, body);
+		}
+		if (storage == nullptr) {
+			// bands this generation didn't change stay shared with the copies of the board
+			next.shareUnchanged (board);
+		}
+		board.swap (next);
+		if (storage != nullptr) {
+			spare.swap (next);
 		}
-		board = result;
+		changed();
 		return *this;
 	}
 
 	/**
-	 * @brief counts number of neighbors of the given cell
-	 * @param r row
-	 * @param c column
-	 * @return the number of neighbors
+	 * @brief performs the given number of steps
+	 * linear rules (see isLinear) jump there in O(log generations) GF(2) matrix products,
+	 * any other rule steps one generation at a time
+	 * @param generations the number of steps
+	 * @return a reference to the board after the steps
 	 **/
-	int Board::countNeighbors (const int r, const int c) {
-		int count = 0;
-		for (int i = max (r - 1, 0); i <= min (r + 1, board.getHeight() - 1); i++) {
-			for (int j = max (c - 1, 0); j <= min (c + 1, board.getWidth() - 1); j++) {
-				if ( (i == r) && (j == c)) {
-					continue;
+	Board &Board::step (const long generations) {
+		if (generations <= 0) {
+			return *this;
+		}
+		if (!isLinear() || growing) {
+			for (long i = 0; i < generations; i++) {
+				step();
+			}
+			return *this;
+		}
+		if (edits != nullptr) {
+			edits->apply (*this);
+		}
+		sync();
+		if ( (birth & ALL_COUNTS) == 0) {
+			// nothing is born - everything dies or everything survives
+			if ( (survival & ALL_COUNTS) == 0) {
+				reset();
+			}
+			return *this;
+		}
+		changed();
+		// with H and W the neighborhood matrices, H*X*W is the parity of every 3x3 block
+		Matrix<bool> rows = neighborhood (getHeight());
+		Matrix<bool> columns = neighborhood (getWidth());
+		if ( (survival & ALL_COUNTS) == EVEN_COUNTS) {
+			// parity of the cell and its neighbors: X' = H*X*W
+			board = rows.power (generations) * board * columns.power (generations);
+		} else {
+			// parity of the neighbors: X' = (M + I)X with MX = H*X*W.
+			// over GF(2), (M + I)^n is the product of (M^(2^i) + I) over the set bits i of n
+			for (unsigned long n = generations; n > 0; n >>= 1) {
+				if (n & 1) {
+					board += rows * board * columns;
 				}
-				if (board (i, j)) {
-					count++;
+				if (n > 1) {
+					rows *= rows;
+					columns *= columns;
 				}
 			}
 		}
+		return *this;
+	}
+
+	/**
+	 * @brief sets a queue whose edits are applied at the start of every step
+	 * (so other threads can edit the board while it steps - see EditQueue)
+	 * @param queue the queue (nullptr - none), used by the stepping thread only
+	 * @return *this
+	 **/
+	Board &Board::setEdits (EditQueue *queue) {
+		edits = queue;
+		return *this;
+	}
+
+	/**
+	 * @brief sets the scheduler that runs the tiles of step() - e.g. one with fewer workers
+	 * than the shared scheduler's one per hardware thread
+	 * @param tiles the scheduler (nullptr - the shared one), it must outlive the board and its copies
+	 * @return *this
+	 **/
+	Board &Board::setScheduler (TileScheduler *tiles) {
+		scheduler = tiles;
+		return *this;
+	}
+
+	/**
+	 * @brief returns the scheduler that runs the tiles of step()
+	 * @return the scheduler
+	 **/
+	TileScheduler &Board::getScheduler() const {
+		return scheduler != nullptr ? *scheduler : TileScheduler::shared();
+	}
+
+	/**
+	 * @brief parses a rule in B/S notation, e.g. B3/S23 (the slash is optional, case is ignored),
+	 * or in the older S/B notation of digits only, e.g. 23/3. a suffix after ':' (the topology
+	 * of some RLE headers, e.g. B3/S23:T100,100) is ignored
+	 * @param rule the rule
+	 * @param survival the neighbor counts a cell survives with (a bit per count, as the constructor takes)
+	 * @param birth the neighbor counts a cell is born with
+	 * @return false if the rule is malformed (survival and birth are then unchanged)
+	 **/
+	bool Board::parseRule (const string &rule, unsigned int &survival, unsigned int &birth) {
+		const string counted = rule.substr (0, rule.find (':'));
+		unsigned int counts[2] = { 0, 0 };
+		const size_t slash = counted.find ('/');
+		if (slash != string::npos && counted.find_first_not_of ("012345678/") == string::npos
+		        && counted.find ('/', slash + 1) == string::npos) {
+			// S/B: the survival counts come first
+			for (size_t i = 0; i < counted.size(); i++) {
+				if (i != slash) {
+					counts[i < slash ? 1 : 0] |= 1u << (counted[i] - '0');
+				}
+			}
+		} else {
+			int part = -1;
+			for (size_t i = 0; i < counted.size(); i++) {
+				const char c = counted[i];
+				if (c == 'B' || c == 'b') {
+					part = 0;
+				} else if (c == 'S' || c == 's') {
+					part = 1;
+				} else if (c >= '0' && c <= '8' && part >= 0) {
+					counts[part] |= 1u << (c - '0');
+				} else if (c != '/' || part < 0) {
+					return false;
+				}
+			}
+			if (part < 0) {
+				return false;
+			}
+		}
+		birth = counts[0];
+		survival = counts[1];
+		return true;
+	}
+
+	/**
+	 * @brief returns the rule in B/S notation
+	 * @return the rule, e.g. B3/S23
+	 **/
+	string Board::getRule() const {
+		string ret = "B";
+		for (int i = 0; i <= 8; i++) {
+			if (birth & (1u << i)) {
+				ret += char ('0' + i);
+			}
+		}
+		ret += "/S";
+		for (int i = 0; i <= 8; i++) {
+			if (survival & (1u << i)) {
+				ret += char ('0' + i);
+			}
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief checks if the rule is linear over GF(2),
+	 * i.e. the next state is an XOR of the cell and/or the parity of its neighbors:
+	 * B1357/S1357 (replicator), B1357/S02468 (Fredkin), and the trivial B/S and B/S012345678
+	 * @return true if the rule is linear
+	 **/
+	bool Board::isLinear() const {
+		unsigned int b = birth & ALL_COUNTS;
+		unsigned int s = survival & ALL_COUNTS;
+		if (b == 0) {
+			return s == 0 || s == ALL_COUNTS;
+		}
+		return b == ODD_COUNTS && (s == ODD_COUNTS || s == EVEN_COUNTS);
+	}
+
+	/**
+	 * @brief builds the size*size neighborhood matrix (ones on and next to the diagonal)
+	 * @param size the size
+	 * @return the neighborhood matrix
+	 **/
+	Matrix<bool> Board::neighborhood (const int size) {
+		Matrix<bool> ret (size);
+		for (int i = 0; i < size; i++) {
+			for (int j = max (i - 1, 0); j <= min (i + 1, size - 1); j++) {
+				ret (i, j) = true;
+			}
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief performs a single step of the event engine:
+	 * only the cells that flipped in the last generation and their neighbors can flip now,
+	 * so just those are evaluated, and the neighbor counts are updated around the new flips.
+	 * cells edited since are among them (see edited), after a bulk edit the counts are rebuilt
+	 * and every cell is evaluated once.
+	 **/
+	void Board::stepEvents() {
+		const int height = getHeight(), width = getWidth();
+		const int bits = Matrix<bool>::wordBits;
+		vector<int> flips;
+		auto evaluate = [this, width, bits, &flips] (const int index) {
+			const int r = index / width, c = index % width;
+			const bool alive = (getCells().rowWords (r) [c / bits] >> (c % bits)) & 1;
+			if ( ( ( (alive ? survival : birth) >> neighbors[index]) & 1) != (unsigned int) alive) {
+				flips.push_back (index);
+			}
+		};
+		if (!eventsValid) {
+			countNeighbors();
+			for (int index = 0; index < height * width; index++) {
+				evaluate (index);
+			}
+		} else {
+			if (++stamp == 0) {
+				std::fill (queued.begin(), queued.end(), 0);
+				stamp = 1;
+			}
+			for (int index : flipped) {
+				const int r = index / width, c = index % width;
+				for (int i = max (r - 1, 0); i <= min (r + 1, height - 1); i++) {
+					for (int j = max (c - 1, 0); j <= min (c + 1, width - 1); j++) {
+						const int candidate = i * width + j;
+						if (queued[candidate] != stamp) {
+							queued[candidate] = stamp;
+							evaluate (candidate);
+						}
+					}
+				}
+			}
+		}
+		for (int index : flips) {
+			const int r = index / width, c = index % width;
+			word &cell = board.rowWords (r) [c / bits];
+			cell ^= bitOf (c);
+			const int delta = (cell & bitOf (c)) ? 1 : -1;
+			for (int i = max (r - 1, 0); i <= min (r + 1, height - 1); i++) {
+				for (int j = max (c - 1, 0); j <= min (c + 1, width - 1); j++) {
+					if (i != r || j != c) {
+						neighbors[i * width + j] += delta;
+					}
+				}
+			}
+		}
+		flipped.swap (flips);
+		eventsValid = true;
+	}
+
+	/**
+	 * @brief rebuilds the neighbor counts of the event engine from the cells
+	 **/
+	void Board::countNeighbors() {
+		const int height = getHeight(), width = getWidth();
+		const int bits = Matrix<bool>::wordBits;
+		neighbors.assign (size_t (height) * width, 0);
+		queued.assign (size_t (height) * width, 0);
+		stamp = 0;
+		for (int r = 0; r < height; r++) {
+			const word *row = getCells().rowWords (r);
+			for (int w = 0; w < board.getStride(); w++) {
+				for (word live = row[w]; live != 0; live &= live - 1) {
+					const int c = w * bits + __builtin_ctzll (live);
+					for (int i = max (r - 1, 0); i <= min (r + 1, height - 1); i++) {
+						for (int j = max (c - 1, 0); j <= min (c + 1, width - 1); j++) {
+							if (i != r || j != c) {
+								neighbors[i * width + j]++;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief counts the live cells of a tile and the words around it
+	 * @param tile the tile
+	 * @return the number of live cells
+	 **/
+	long Board::activity (const Tile &tile) const {
+		const int last = min (tile.word + tile.words + 1, board.getStride());
+		long count = 0;
+		for (int i = max (tile.row - 1, 0); i < min (tile.row + tile.height + 1, getHeight()); i++) {
+			const word *row = board.rowWords (i);
+			for (int w = max (tile.word - 1, 0); w < last; w++) {
+				count += __builtin_popcountll (row[w]);
+			}
+		}
 		return count;
 	}
 
+	/**
+	 * @brief turns a rule into masks over the neighbor counts that matter
+	 * @param birth the birth rule
+	 * @param survival the survival rule
+	 **/
+	Board::Rules::Rules (const unsigned int birth, const unsigned int survival) : size (0) {
+		for (int n = 0; n <= 8; n++) {
+			if ( ( (birth | survival) >> n) & 1) {
+				counts[size] = n;
+				born[size] = ( (birth >> n) & 1) ? ~word (0) : 0;
+				survives[size] = ( (survival >> n) & 1) ? ~word (0) : 0;
+				size++;
+			}
+		}
+	}
+
+	/**
+	 * @brief computes the next generation of a word of cells
+	 * the 8 neighbor words are summed into 4 bit planes with full adders,
+	 * and the rule is applied to all 64 counts at once
+	 * @param west the west neighbors of the rows above, of and below the word
+	 * @param centre the rows above, of and below the word
+	 * @param east the east neighbors of the rows above, of and below the word
+	 * @return the next generation of the word
+	 **/
+	Board::word Board::Rules::apply (const word *west, const word *centre, const word *east) const {
+		// ones of the three groups, then twos, into the count bits c0..c3
+		word s0, t0, s1, t1;
+		fullAdd (west[0], centre[0], east[0], s0, t0);
+		fullAdd (west[1], east[1], west[2], s1, t1);
+		const word s2 = centre[2] ^ east[2], t2 = centre[2] & east[2];
+		word c0, t3, u0, u1, c1, u2;
+		fullAdd (s0, s1, s2, c0, t3);
+		fullAdd (t0, t1, t2, u0, u1);
+		c1 = u0 ^ t3;
+		u2 = u0 & t3;
+		const word c2 = u1 ^ u2, c3 = u1 & u2;
+		const word alive = centre[1];
+		word result = 0;
+		for (int r = 0; r < size; r++) {
+			const int n = counts[r];
+			const word match = (n & 1 ? c0 : ~c0) & (n & 2 ? c1 : ~c1) & (n & 4 ? c2 : ~c2) & (n & 8 ? c3 : ~c3);
+			result |= match & ( (born[r] & ~alive) | (survives[r] & alive));
+		}
+		return result;
+	}
+
+	/**
+	 * @brief computes the next generation of a tile, 64 cells at a time (see Rules)
+	 * @param next the next generation (only the words of the tile are written)
+	 * @param tile the tile
+	 **/
+	void Board::stepTile (Matrix<bool> &next, const Tile &tile) const {
+		const int bits = Matrix<bool>::wordBits;
+		const int height = getHeight();
+		const int stride = board.getStride();
+		const int used = getWidth() % bits;
+		const word padding = used == 0 ? ~word (0) : (word (1) << used) - 1;
+		const Rules rules (birth, survival);
+		for (int i = tile.row; i < tile.row + tile.height; i++) {
+			const word *rows[3] = {
+				i > 0 ? board.rowWords (i - 1) : nullptr,
+				board.rowWords (i),
+				i + 1 < height ? board.rowWords (i + 1) : nullptr
+			};
+			word *target = next.rowWords (i);
+			for (int w = tile.word; w < tile.word + tile.words; w++) {
+				// west[k] holds the west neighbor of every cell of row i - 1 + k, east[k] the east one
+				word west[3], centre[3], east[3];
+				for (int k = 0; k < 3; k++) {
+					if (rows[k] == nullptr) {
+						west[k] = centre[k] = east[k] = 0;
+						continue;
+					}
+					const word before = w > 0 ? rows[k][w - 1] : 0;
+					const word after = w + 1 < stride ? rows[k][w + 1] : 0;
+					centre[k] = rows[k][w];
+					west[k] = (centre[k] << 1) | (before >> (bits - 1));
+					east[k] = (centre[k] >> 1) | (after << (bits - 1));
+				}
+				word result = rules.apply (west, centre, east);
+				if (w == stride - 1) {
+					result &= padding;
+				}
+				target[w] = result;
+			}
+		}
+	}
+
+	/**
+	 * @brief performs a single step in the MORTON layout
+	 * the board is cut into the same rectangles as in step(), made of whole tiles,
+	 * and every tile of a rectangle is stepped from itself and the edges of its 8 neighbors
+	 **/
+	void Board::stepMorton() {
+		const int height = getHeight(), width = getWidth();
+		const int side = MortonTiles::SIDE;
+		if (tilesStale || !tiles.fits (height, width)) {
+			tiles.pack (board);
+			tilesStale = false;
+		}
+		if (!spareTiles.fits (height, width)) {
+			spareTiles.resize (height, width);
+		}
+		const int columns = tiles.getTileColumns();
+		vector<Tile> rectangles;
+		for (int r = 0; r < height; r += TILE_ROWS) {
+			for (int c = 0; c < columns; c += TILE_WORDS) {
+				rectangles.push_back (Tile { r, min (TILE_ROWS, height - r), c, min (TILE_WORDS, columns - c) });
+			}
+		}
+		const bool skipEmpty = (birth & 1) == 0;
+		const Rules rules (birth, survival);
+		TileScheduler::Body body = [this, skipEmpty, &rules, side] (const Tile & tile, vector<Tile> &parts) -> long {
+			const int r0 = tile.row / side, r1 = (tile.row + tile.height + side - 1) / side;
+			long live = activity (tiles, tile);
+			if (live == 0 && skipEmpty) {
+				// the buffer holds an older generation
+				for (int r = r0; r < r1; r++) {
+					for (int c = tile.word; c < tile.word + tile.words; c++) {
+						std::fill (spareTiles.tile (r, c), spareTiles.tile (r, c) + side, 0);
+					}
+				}
+				return 0;
+			}
+			if (live > SPLIT_POPULATION) {
+				// halve the longer side, in whole tiles
+				if (tile.words > 1 && tile.words * side >= tile.height) {
+					int half = tile.words / 2;
+					parts.push_back (Tile { tile.row, tile.height, tile.word, half });
+					parts.push_back (Tile { tile.row, tile.height, tile.word + half, tile.words - half });
+					return 0;
+				}
+				if (r1 - r0 >= 2) {
+					int half = (r1 - r0) / 2 * side;
+					parts.push_back (Tile { tile.row, half, tile.word, tile.words });
+					parts.push_back (Tile { tile.row + half, tile.height - half, tile.word, tile.words });
+					return 0;
+				}
+			}
+			for (int r = r0; r < r1; r++) {
+				for (int c = tile.word; c < tile.word + tile.words; c++) {
+					stepMortonTile (spareTiles, r, c, rules);
+				}
+			}
+			return long (tile.height) * tile.words * side;
+		};
+		if (long (height) * width < PARALLEL_CELLS) {
+			TileScheduler::serial (rectangles, body);
+		} else {
+			getScheduler().run (rectangles, body);
+		}
+		tiles.swap (spareTiles);
+		rowsStale = true;
+		countsValid = false;
+		eventsValid = false;
+	}
+
+	/**
+	 * @brief counts the live cells of a rectangle of tiles and the words around it
+	 * @param cells the tiles
+	 * @param tile the rectangle (rows, and columns of tiles)
+	 * @return the number of live cells
+	 **/
+	long Board::activity (const MortonTiles &cells, const Tile &tile) const {
+		const int side = MortonTiles::SIDE;
+		const int first = max (tile.row - 1, 0), last = min (tile.row + tile.height + 1, getHeight());
+		const int end = min (tile.word + tile.words + 1, cells.getTileColumns());
+		long count = 0;
+		for (int c = max (tile.word - 1, 0); c < end; c++) {
+			for (int i = first; i < last;) {
+				const word *words = cells.tile (i / side, c);
+				for (const int stop = min (last, (i / side + 1) * side); i < stop; i++) {
+					count += __builtin_popcountll (words[i % side]);
+				}
+			}
+		}
+		return count;
+	}
+
+	/**
+	 * @brief computes the next generation of a tile of the MORTON layout, a row at a time (see Rules)
+	 * @param next the next generation (only the tile is written)
+	 * @param r the tile row
+	 * @param c the tile column
+	 * @param rules the rule
+	 **/
+	void Board::stepMortonTile (MortonTiles &next, const int r, const int c, const Rules &rules) const {
+		const int side = MortonTiles::SIDE;
+		// the tile and its 8 neighbors, nullptr outside of the board
+		const word *around[3][3];
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				around[i][j] = tiles.tile (r - 1 + i, c - 1 + j);
+			}
+		}
+		const int used = getWidth() % side;
+		const word padding = c == tiles.getTileColumns() - 1 && used != 0 ? (word (1) << used) - 1 : ~word (0);
+		const int rows = min (side, getHeight() - r * side);
+		word *target = next.tile (r, c);
+		for (int i = 0; i < rows; i++) {
+			// west[k] holds the west neighbor of every cell of row i - 1 + k, east[k] the east one
+			word west[3], centre[3], east[3];
+			for (int k = 0; k < 3; k++) {
+				int row = i - 1 + k, band = 1;
+				if (row < 0) {
+					band = 0;
+					row = side - 1;
+				} else if (row >= side) {
+					band = 2;
+					row = 0;
+				}
+				const word *const *line = around[band];
+				if (line[1] == nullptr) {
+					west[k] = centre[k] = east[k] = 0;
+					continue;
+				}
+				const word before = line[0] != nullptr ? line[0][row] : 0;
+				const word after = line[2] != nullptr ? line[2][row] : 0;
+				centre[k] = line[1][row];
+				west[k] = (centre[k] << 1) | (before >> (side - 1));
+				east[k] = (centre[k] >> 1) | (after << (side - 1));
+			}
+			target[i] = rules.apply (west, centre, east) & padding;
+		}
+		std::fill (target + rows, target + side, 0);
+	}
+
+	/**
+	 * @brief adds three words bitwise
+	 * @param a,b,c the words
+	 * @param sum the ones
+	 * @param carry the twos
+	 **/
+	void Board::fullAdd (const word a, const word b, const word c, word &sum, word &carry) {
+		const word half = a ^ b;
+		sum = half ^ c;
+		carry = (a & b) | (half & c);
+	}
+
 	/**
 	 * @brief toggles the given coordinates
 	 * @param r row
@@ -130,7 +801,7 @@ namespace Life {
 	 * @return *this
 	 **/
 	Board &Board::toggle (const int r, const int c) {
-		(*this) (r, c) = ! (*this) (r, c);
+		(*this) (r, c).flip();
 		return *this;
 	}
 
@@ -150,29 +821,622 @@ namespace Life {
 	 * @return *this
 	 **/
 	Board &Board::updateList (const list<pair<int, int>> &l, const bool update) {
-for (auto & i: l) {
-			if (update) {
-				(*this) (i.first, i.second) = true;
-			} else {
-				toggle (i);
+		vector<pair<int, int>> coordinates (l.begin(), l.end());
+		return this->update (coordinates, update ? SET : TOGGLE);
+	}
+
+	/**
+	 * @brief updates a span of coordinates
+	 * bounds are checked once for the whole span (nothing is changed if any coordinate is out of bounds),
+	 * consecutive coordinates in the same 64-bit word (e.g. sorted input) are merged into a single write
+	 * @param coordinates the first (row, column) pair
+	 * @param count the number of pairs
+	 * @param operation SET, CLEAR or TOGGLE (COPY acts as SET)
+	 * @return *this
+	 **/
+	Board &Board::update (const pair<int, int> *coordinates, const size_t count, const Operation operation) {
+		sync();
+		if (growing && count > 0) {
+			int r0 = coordinates[0].first, c0 = coordinates[0].second, r1 = r0, c1 = c0;
+			for (size_t i = 1; i < count; i++) {
+				r0 = min (r0, coordinates[i].first);
+				r1 = max (r1, coordinates[i].first);
+				c0 = min (c0, coordinates[i].second);
+				c1 = max (c1, coordinates[i].second);
+			}
+			include (r0, c0, r1, c1);
+		}
+		for (size_t i = 0; i < count; i++) {
+			if (coordinates[i].first < top || coordinates[i].first >= top + getHeight()
+			        || coordinates[i].second < left || coordinates[i].second >= left + getWidth()) {
+				throw OutOfBounds();
+			}
+		}
+		// a few edits are followed by the event engine, more are cheaper to recount
+		const bool follow = eventsValid && long (count) * EDIT_REBUILD_SHARE < long (getHeight()) * getWidth();
+		if (follow) {
+			countsValid = false;
+			tilesStale = true;
+		} else {
+			changed();
+		}
+		size_t i = 0;
+		while (i < count) {
+			const int row = coordinates[i].first - top;
+			const int base = (coordinates[i].second - left) / Matrix<bool>::wordBits * Matrix<bool>::wordBits;
+			word *target = board.rowWords (row) + base / Matrix<bool>::wordBits;
+			word mask = 0;
+			for (; i < count; i++) {
+				const int col = coordinates[i].second - left;
+				word *w = board.rowWords (coordinates[i].first - top) + col / Matrix<bool>::wordBits;
+				if (w != target) {
+					break;
+				}
+				if (operation == TOGGLE) {
+					mask ^= bitOf (col);
+				} else {
+					mask |= bitOf (col);
+				}
+			}
+			const word before = *target;
+			apply (*target, mask, mask, operation);
+			if (follow) {
+				for (word flips = before ^ *target; flips != 0; flips &= flips - 1) {
+					edited (row, base + __builtin_ctzll (flips));
+				}
 			}
 		}
 		return *this;
 	}
 
+	/**
+	 * @brief updates a vector of coordinates
+	 * @param coordinates the (row, column) pairs
+	 * @param operation SET, CLEAR or TOGGLE (COPY acts as SET)
+	 * @return *this
+	 **/
+	Board &Board::update (const vector<pair<int, int>> &coordinates, const Operation operation) {
+		return update (coordinates.data(), coordinates.size(), operation);
+	}
+
+	/**
+	 * @brief draws a bitmap onto the board, a whole word at a time
+	 * the bitmap must fit in the board (checked once) - a growing board is extended to it
+	 * @param bitmap the cells to draw
+	 * @param row the target row of the bitmap's top left corner
+	 * @param col the target column of the bitmap's top left corner
+	 * @param operation COPY (replace), SET (or), CLEAR (and not) or TOGGLE (xor)
+	 * @return *this
+	 **/
+	Board &Board::blit (const Matrix<bool> &bitmap, const int row, const int col, const Operation operation) {
+		sync();
+		if (growing && bitmap.getHeight() > 0) {
+			include (row, col, row + bitmap.getHeight() - 1, col + bitmap.getWidth() - 1);
+		}
+		if (row < top || col < left || row + bitmap.getHeight() > top + getHeight()
+		        || col + bitmap.getWidth() > left + getWidth()) {
+			throw OutOfBounds();
+		}
+		changed();
+		for (int i = 0; i < bitmap.getHeight(); i++) {
+			copyBits (bitmap.rowWords (i), 0, board.rowWords (row - top + i), col - left, bitmap.getWidth(), operation);
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief draws a region of a board (possibly this one) onto the board
+	 * both regions must be in bounds (checked once) - a growing board is extended to the target region
+	 * @param source the source board
+	 * @param sourceRow the top row of the region
+	 * @param sourceCol the left column of the region
+	 * @param height the height of the region
+	 * @param width the width of the region
+	 * @param row the target row of the region's top left corner
+	 * @param col the target column of the region's top left corner
+	 * @param operation COPY (replace), SET (or), CLEAR (and not) or TOGGLE (xor)
+	 * @return *this
+	 **/
+	Board &Board::blit (const Board &source, const int sourceRow, const int sourceCol, const int height,
+	                    const int width, const int row, const int col, const Operation operation) {
+		if (height < 0 || width < 0 || sourceRow < source.top || sourceCol < source.left
+		        || sourceRow + height > source.top + source.getHeight()
+		        || sourceCol + width > source.left + source.getWidth()) {
+			throw OutOfBounds();
+		}
+		if (height == 0 || width == 0) {
+			return *this;
+		}
+		sync();
+		source.sync();
+		if (&source == this || growing) {
+			// the regions may overlap (or this board may move) - go through a copy
+			Matrix<bool> region (height, width);
+			for (int i = 0; i < height; i++) {
+				copyBits (source.board.rowWords (sourceRow - source.top + i), sourceCol - source.left, region.rowWords (i),
+				          0, width, COPY);
+			}
+			return blit (region, row, col, operation);
+		}
+		if (row < top || col < left || row + height > top + getHeight() || col + width > left + getWidth()) {
+			throw OutOfBounds();
+		}
+		changed();
+		for (int i = 0; i < height; i++) {
+			copyBits (source.board.rowWords (sourceRow - source.top + i), sourceCol - source.left,
+			          board.rowWords (row - top + i), col - left, width, operation);
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief returns the number of live cells
+	 * @return the population of the board
+	 **/
+	long Board::population() const {
+		return rowsStale ? tiles.count() : board.count();
+	}
+
+	/**
+	 * @brief hashes the cells (and the size) of the board
+	 * equal boards hash equally - used to spot repeating generations
+	 * @return a 64 bit hash
+	 **/
+	uint64_t Board::hash() const {
+		sync();
+		uint64_t h = 0xCBF29CE484222325ULL ^ (uint64_t (getHeight()) << 32 | uint32_t (getWidth()));
+		for (int i = 0; i < getHeight(); i++) {
+			const word *row = board.rowWords (i);
+			for (int w = 0; w < board.getStride(); w++) {
+				h = (h ^ row[w]) * 0x100000001B3ULL;
+				h ^= h >> 29;
+			}
+		}
+		return h;
+	}
+
+	/**
+	 * @brief returns the cells as a bit matrix (row i, column j is cell getTop() + i, getLeft() + j)
+	 * @return the cells
+	 **/
+	const Matrix<bool> &Board::getCells() const {
+		sync();
+		return board;
+	}
+
+	/**
+	 * @brief returns the number of live cells in a rectangle, in O(1)
+	 * the first query after the board changed rebuilds a summed-area table in O(height*width),
+	 * boards that are never queried don't pay for it.
+	 * a growing board counts the part of the rectangle it covers
+	 * @param row the top row of the rectangle
+	 * @param col the left column of the rectangle
+	 * @param height the height of the rectangle
+	 * @param width the width of the rectangle
+	 * @return the population of the rectangle
+	 **/
+	long Board::population (const int row, const int col, const int height, const int width) const {
+		if (height < 0 || width < 0) {
+			throw OutOfBounds();
+		}
+		int r0 = row - top, c0 = col - left, r1 = r0 + height, c1 = c0 + width;
+		if (growing) {
+			r0 = max (r0, 0);
+			c0 = max (c0, 0);
+			r1 = min (r1, getHeight());
+			c1 = min (c1, getWidth());
+			if (r0 >= r1 || c0 >= c1) {
+				return 0;
+			}
+		} else if (r0 < 0 || c0 < 0 || r1 > getHeight() || c1 > getWidth()) {
+			throw OutOfBounds();
+		}
+		if (!countsValid) {
+			sync();
+			buildCounts();
+		}
+		const size_t stride = getWidth() + 1;
+		const size_t upper = r0 * stride, lower = r1 * stride;
+		return long (counts[lower + c1]) - counts[lower + c0] - counts[upper + c1] + counts[upper + c0];
+	}
+
+	/**
+	 * @brief marks the cells as changed (invalidates the summed-area table)
+	 **/
+	void Board::changed() {
+		countsValid = false;
+		eventsValid = false;
+		tilesStale = true;
+	}
+
+	/**
+	 * @brief updates the event engine around a cell that was just flipped by an edit:
+	 * the counts of its neighbors, and the cell is queued like a flip of the last generation
+	 * @param r the row (from the top of the board)
+	 * @param c the column (from the left of the board)
+	 **/
+	void Board::edited (const int r, const int c) {
+		const int height = getHeight(), width = getWidth();
+		const int delta = (board.rowWords (r) [c / Matrix<bool>::wordBits] & bitOf (c)) ? 1 : -1;
+		for (int i = max (r - 1, 0); i <= min (r + 1, height - 1); i++) {
+			for (int j = max (c - 1, 0); j <= min (c + 1, width - 1); j++) {
+				if (i != r || j != c) {
+					neighbors[i * width + j] += delta;
+				}
+			}
+		}
+		flipped.push_back (r * width + c);
+	}
+
+	/**
+	 * @brief brings the rows up to date after MORTON steps
+	 * (the rows are a cache of the tiles then, so this is logically const)
+	 **/
+	void Board::sync() const {
+		if (rowsStale) {
+			tiles.unpack (const_cast<Matrix<bool> &> (board));
+			rowsStale = false;
+		}
+	}
+
+	/**
+	 * @brief builds the summed-area table:
+	 * counts[i][j] is the population of the cells above row i and left of column j
+	 **/
+	void Board::buildCounts() const {
+		const int height = getHeight(), width = getWidth();
+		const size_t stride = width + 1;
+		counts.assign ( (height + 1) * stride, 0);
+		for (int i = 0; i < height; i++) {
+			const word *row = board.rowWords (i);
+			const uint32_t *above = &counts[i * stride];
+			uint32_t *current = &counts[ (i + 1) * stride];
+			uint32_t sum = 0;
+			for (int j = 0; j < width; j++) {
+				sum += (row[j / Matrix<bool>::wordBits] >> (j % Matrix<bool>::wordBits)) & 1;
+				current[j + 1] = above[j + 1] + sum;
+			}
+		}
+		countsValid = true;
+	}
+
+	/**
+	 * @brief returns the bit of a column within its word
+	 * @param col the column
+	 * @return the mask of the column's bit
+	 **/
+	Board::word Board::bitOf (const int col) {
+		return word (1) << (col % Matrix<bool>::wordBits);
+	}
+
+	/**
+	 * @brief applies an operation to the masked bits of a word
+	 * @param target the word to update
+	 * @param bits the source bits (only the masked ones are used)
+	 * @param mask the bits to update
+	 * @param operation the operation
+	 **/
+	void Board::apply (word &target, const word bits, const word mask, const Operation operation) {
+		switch (operation) {
+		case COPY:
+			target = (target & ~mask) | (bits & mask);
+			break;
+		case SET:
+			target |= bits & mask;
+			break;
+		case CLEAR:
+			target &= ~ (bits & mask);
+			break;
+		case TOGGLE:
+			target ^= bits & mask;
+			break;
+		}
+	}
+
+	/**
+	 * @brief applies an operation from a range of bits to another, a word at a time
+	 * @param source the source row
+	 * @param sourceCol the first source bit
+	 * @param target the target row
+	 * @param col the first target bit
+	 * @param count the number of bits
+	 * @param operation the operation
+	 **/
+	void Board::copyBits (const word *source, const int sourceCol, word *target, const int col, const int count,
+	                      const Operation operation) {
+		const int bits = Matrix<bool>::wordBits;
+		for (int done = 0; done < count;) {
+			int position = col + done;
+			int shift = position % bits;
+			int n = min (bits - shift, count - done);
+			// n source bits starting at sourceCol + done
+			int from = sourceCol + done;
+			word value = source[from / bits] >> (from % bits);
+			if (from % bits + n > bits) {
+				value |= source[from / bits + 1] << (bits - from % bits);
+			}
+			word mask = (n == bits ? ~word (0) : (word (1) << n) - 1) << shift;
+			apply (target[position / bits], value << shift, mask, operation);
+			done += n;
+		}
+	}
+
 	/**
 	 * @brief resets the board
 	 * @return *this
 	 **/
 	Board &Board::reset() {
-		for (int i = 0; i < board.getHeight(); i++) {
-			for (int j = 0; j < board.getWidth(); j++) {
-				(*this) (i, j) = false;
+		rowsStale = false;
+		changed();
+		// bands shared with copies are dropped rather than copied
+		board.unshare (false);
+		return *this;
+	}
+
+	/**
+	 * @brief moves the cells to page storage, optionally backed by huge pages, for large boards:
+	 * lets the workers of the board's TileScheduler first touch (and so place on their NUMA nodes)
+	 * the bands of TILE_ROWS rows they are dealt by step().
+	 * the bands stay with the workers that placed them only if the workers stay on their CPUs: a scheduler
+	 * given to the board (setScheduler) is pinned (the stepping thread only while it steps). the shared one,
+	 * which every other board, the census and the server step on as well, is left as it is.
+	 * the next generation is computed into a second, equally placed buffer, and the two are swapped.
+	 * @param huge the kind of pages
+	 * @return *this
+	 **/
+	Board &Board::setStorage (const ::Matrix::PageResource::HugePages huge) {
+		sync();
+		TileScheduler &pool = getScheduler();
+		if (scheduler != nullptr) {
+			pool.pin();
+		}
+		storage = ::Matrix::PageResource::get (huge);
+		const int height = getHeight(), stride = board.getStride();
+		Matrix<bool> placed (height, getWidth(), storage), second (height, getWidth(), storage);
+		vector<Tile> bands;
+		for (int r = 0; r < height; r += TILE_ROWS) {
+			bands.push_back (Tile { r, min (TILE_ROWS, height - r), 0, stride });
+		}
+		pool.run (bands, [this, &placed, &second, stride] (const Tile & band, vector<Tile> &) -> long {
+			for (int i = band.row; i < band.row + band.height; i++) {
+				std::copy (getCells().rowWords (i), getCells().rowWords (i) + stride, placed.rowWords (i));
+				std::fill (second.rowWords (i), second.rowWords (i) + stride, 0);
 			}
+			return long (band.height) * stride;
+		}, false);
+		board.swap (placed);
+		spare.swap (second);
+		changed();
+		return *this;
+	}
+
+	/**
+	 * @brief reports where the cells live
+	 * @return the NUMA node of every band of TILE_ROWS rows (-1 if unknown)
+	 **/
+	vector<int> Board::getBandNodes() const {
+		vector<int> nodes;
+		for (int r = 0; r < getHeight(); r += TILE_ROWS) {
+			nodes.push_back (::Matrix::PageResource::nodeOf (board.rowWords (r)));
 		}
+		return nodes;
+	}
+
+	/**
+	 * @brief selects how step() computes generations
+	 * EVENTS costs O(changes) per generation (plus a byte of neighbor count per cell),
+	 * TILED O(cells / 64) - better when much of the board changes
+	 * @param e the engine
+	 * @return *this
+	 **/
+	Board &Board::setEngine (const Engine e) {
+		engine = e;
+		eventsValid = false;
 		return *this;
 	}
 
+	/**
+	 * @brief returns the engine used by step()
+	 * @return the engine
+	 **/
+	Board::Engine Board::getEngine() const {
+		return engine;
+	}
+
+	/**
+	 * @brief selects how the TILED engine keeps the cells while stepping
+	 * MORTON steps 64x64 tiles in Z order, so the rows above and below a cell are next to it in memory -
+	 * on boards much wider than a cache line it misses the caches and the TLB less than ROW_MAJOR.
+	 * the rows are brought up to date when they are next read (cell reads and population() use the tiles),
+	 * so a run of steps pays for the conversions once. growing boards and the event engine step the rows.
+	 * @param l the layout
+	 * @return *this
+	 **/
+	Board &Board::setLayout (const Layout l) {
+		if (l == ROW_MAJOR) {
+			sync();
+			tiles.clear();
+			spareTiles.clear();
+			tilesStale = true;
+		}
+		layout = l;
+		return *this;
+	}
+
+	/**
+	 * @brief returns the layout used by the TILED engine
+	 * @return the layout
+	 **/
+	Board::Layout Board::getLayout() const {
+		return layout;
+	}
+
+	/**
+	 * @brief returns the number of cells that flipped in the last generation of the event engine
+	 * (counting the cells edited since)
+	 * @return the number of changes (0 if unknown)
+	 **/
+	long Board::getChanges() const {
+		return eventsValid ? flipped.size() : 0;
+	}
+
+	/**
+	 * @brief turns automatic growth on or off
+	 * a growing board extends itself (in chunks) before any live cell could leave it,
+	 * and to any cell written outside of it - coordinates stay valid as the top left corner moves
+	 * (see getTop / getLeft). cells outside of it read as dead.
+	 * (rules giving birth on 0 neighbors fill the plane - they grow without bound)
+	 * @param grow true to grow
+	 * @param shrink true to also crop dead margins periodically
+	 * @return *this
+	 **/
+	Board &Board::setGrowth (const bool grow, const bool shrink) {
+		growing = grow;
+		shrinking = grow && shrink;
+		untilShrink = SHRINK_INTERVAL;
+		return *this;
+	}
+
+	/**
+	 * @brief checks if the board grows automatically
+	 * @return true if growing
+	 **/
+	bool Board::isGrowing() const {
+		return growing;
+	}
+
+	/**
+	 * @brief crops the dead margins, keeping GROWTH_CHUNK / 2 dead cells around the live ones
+	 * (an empty board is left as is)
+	 * @return *this
+	 **/
+	Board &Board::shrink() {
+		sync();
+		int r0, c0, r1, c1;
+		if (liveBounds (r0, c0, r1, c1) && (r0 > 0 || c0 > 0 || r1 < getHeight() - 1 || c1 < getWidth() - 1)) {
+			relocate (top + r0, left + c0, r1 - r0 + 1, c1 - c0 + 1);
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief finds the rectangle of the live cells plus a GROWTH_CHUNK / 2 margin (within the board)
+	 * @param r0 the top row (of the matrix)
+	 * @param c0 the left column
+	 * @param r1 the bottom row (inclusive)
+	 * @param c1 the right column (inclusive)
+	 * @return false if the board is empty
+	 **/
+	bool Board::liveBounds (int &r0, int &c0, int &r1, int &c1) const {
+		const int bits = Matrix<bool>::wordBits;
+		const int stride = board.getStride();
+		int first = -1, last = -1;
+		vector<word> columns (stride, 0);
+		for (int i = 0; i < getHeight(); i++) {
+			const word *row = board.rowWords (i);
+			word any = 0;
+			for (int w = 0; w < stride; w++) {
+				columns[w] |= row[w];
+				any |= row[w];
+			}
+			if (any != 0) {
+				last = i;
+				if (first < 0) {
+					first = i;
+				}
+			}
+		}
+		if (first < 0) {
+			return false;
+		}
+		int low = 0, high = stride - 1;
+		while (columns[low] == 0) {
+			low++;
+		}
+		while (columns[high] == 0) {
+			high--;
+		}
+		const int margin = GROWTH_CHUNK / 2;
+		r0 = max (first - margin, 0);
+		r1 = min (last + margin, getHeight() - 1);
+		c0 = max (low * bits + __builtin_ctzll (columns[low]) - margin, 0);
+		c1 = min (high * bits + bits - 1 - __builtin_clzll (columns[high]) + margin, getWidth() - 1);
+		return true;
+	}
+
+	/**
+	 * @brief extends the board (by at least a chunk per side) to include a rectangle
+	 * @param r0 the top row
+	 * @param c0 the left column
+	 * @param r1 the bottom row (inclusive)
+	 * @param c1 the right column (inclusive)
+	 **/
+	void Board::include (const int r0, const int c0, const int r1, const int c1) {
+		const int height = getHeight(), width = getWidth();
+		const int rowChunk = max (GROWTH_CHUNK, height / 2), colChunk = max (GROWTH_CHUNK, width / 2);
+		int up = r0 < top ? top - r0 + rowChunk : 0;
+		int down = r1 >= top + height ? r1 - (top + height) + 1 + rowChunk : 0;
+		int west = c0 < left ? left - c0 + colChunk : 0;
+		int east = c1 >= left + width ? c1 - (left + width) + 1 + colChunk : 0;
+		if (up + down + west + east > 0) {
+			relocate (top - up, left - west, height + up + down, width + west + east);
+		}
+	}
+
+	/**
+	 * @brief moves the board to a new rectangle, keeping the cells they share
+	 * @param newTop the top row of the new rectangle
+	 * @param newLeft the left column of the new rectangle
+	 * @param height its height
+	 * @param width its width
+	 **/
+	void Board::relocate (const int newTop, const int newLeft, const int height, const int width) {
+		Matrix<bool> moved (height, width, storage != nullptr ? storage : ::Matrix::currentResource());
+		const int r0 = max (top, newTop), r1 = min (top + getHeight(), newTop + height);
+		const int c0 = max (left, newLeft), c1 = min (left + getWidth(), newLeft + width);
+		for (int r = r0; r < r1; r++) {
+			if (c0 < c1) {
+				copyBits (getCells().rowWords (r - top), c0 - left, moved.rowWords (r - newTop), c0 - newLeft, c1 - c0, COPY);
+			}
+		}
+		board.swap (moved);
+		top = newTop;
+		left = newLeft;
+		changed();
+	}
+
+	/**
+	 * @brief before a step of a growing board: extends every side with live cells on it
+	 * (so births stay inside), and periodically crops dead margins if shrinking
+	 **/
+	void Board::grow() {
+		const int bits = Matrix<bool>::wordBits;
+		const int height = getHeight(), width = getWidth();
+		const int stride = board.getStride();
+		// read only - shared bands aren't copied
+		const Matrix<bool> &cells = board;
+		bool up = false, down = false, west = false, east = false;
+		for (int w = 0; w < stride; w++) {
+			up = up || cells.rowWords (0) [w] != 0;
+			down = down || cells.rowWords (height - 1) [w] != 0;
+		}
+		const word lastBit = bitOf (width - 1);
+		for (int i = 0; i < height; i++) {
+			const word *row = cells.rowWords (i);
+			west = west || (row[0] & 1) != 0;
+			east = east || (row[ (width - 1) / bits] & lastBit) != 0;
+		}
+		include (top - up, left - west, top + height - 1 + down, left + width - 1 + east);
+		if (shrinking && --untilShrink <= 0) {
+			// only worth it (and no thrashing) if at least half of the board goes
+			untilShrink = SHRINK_INTERVAL;
+			int r0, c0, r1, c1;
+			if (liveBounds (r0, c0, r1, c1) && long (r1 - r0 + 1) * (c1 - c0 + 1) * 2 <= long (getHeight()) * getWidth()) {
+				relocate (top + r0, left + c0, r1 - r0 + 1, c1 - c0 + 1);
+			}
+		}
+	}
+
 	/**
 	 * @brief returns the height of the board
 	 * @return the height of the board
@@ -189,11 +1453,27 @@ for (auto & i: l) {
 		return board.getWidth();
 	}
 
+	/**
+	 * @brief returns the row of the top cells (0 unless a growing board extended upwards)
+	 * @return the top row
+	 **/
+	int Board::getTop() const {
+		return top;
+	}
+
+	/**
+	 * @brief returns the column of the left cells (0 unless a growing board extended leftwards)
+	 * @return the left column
+	 **/
+	int Board::getLeft() const {
+		return left;
+	}
+
 	/* external functions **/
 	ostream &operator<< (ostream &os, const Board &b) {
 		stringstream s;
 		char c;
-		s << b.board;
+		s << b.getCells();
 		s.read (&c, 1);
 		while (!s.eof()) {
 			switch (c) {
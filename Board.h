@@ -2,9 +2,14 @@
 #define _BOARD_H_
 #include "literals.h"
 #include "matrix.h"
+#include "MortonTiles.h"
+#include "pages.h"
+#include <cstdint>
 #include <iostream>
 #include <utility>
 #include <list>
+#include <string>
+#include <vector>
 
 // output conversion
 #define LIVING_CELL '*'
@@ -19,28 +24,165 @@ namespace Life {
 	using std::ostream;
 	using std::pair;
 	using std::list;
+	using std::string;
+	using std::vector;
+
+	class EditQueue;
+
+	class History;
+
+	struct Tile;
+
+	class TileScheduler;
 
 	class Board {
+		friend class History;
+	public:
+		// bulk update operations (COPY replaces a blitted region, and acts as SET for coordinates)
+		enum Operation { SET, CLEAR, TOGGLE, COPY };
+
+		// how step() computes a generation: every cell, a word at a time (TILED),
+		// or only the cells around last generation's changes (EVENTS)
+		enum Engine { TILED, EVENTS };
+
+		// how the TILED engine keeps the cells while stepping: rows of words (ROW_MAJOR),
+		// or 64x64 tiles in Morton order (MORTON, see MortonTiles)
+		enum Layout { ROW_MAJOR, MORTON };
+
+		// a cell of a board: reading it is a lookup (see the const operator()),
+		// only assigning it edits the board - through update(), which extends a growing board
+		class reference {
+			friend class Board;
+			Board *b;
+			pair<int, int> cell;
+
+			reference (Board *b, const int r, const int c) : b (b), cell (r, c) {}
+		public:
+			operator bool() const;
+
+			reference &operator= (const bool);
+
+			reference &operator= (const reference &);
+
+			reference &flip();
+		};
+	private:
+		typedef Matrix<bool>::word word;
+
+		// the rule as masks over the neighbor counts, applied to a word of cells at once
+		struct Rules {
+			int size;
+			int counts[9];
+			word born[9], survives[9];
+
+			Rules (const unsigned int, const unsigned int);
+
+			word apply (const word *, const word *, const word *) const;
+		};
+
+		// the cells - after a MORTON step they are brought up to date on the next access (see sync)
 		Matrix<bool> board;
 
+		// page storage set by setStorage (nullptr - the usual heap), and the buffer of the next generation
+		::Matrix::MemoryResource *storage;
+		Matrix<bool> spare;
+
 		// binary rules - the i-th binary bit represents i neighbors to apply
 		unsigned int survival, birth;
 
-		int countNeighbors (const int, const int);
+		// auto-growing: live cells reaching an edge extend the board (and dead margins are cropped if shrinking)
+		bool growing, shrinking;
+		// the coordinates of the top left cell - they move as a growing board extends up or left
+		int top, left;
+		// generations until the next shrink check
+		int untilShrink;
+
+		Engine engine;
+		// event engine: the live neighbors of every cell, the cells that flipped in the last generation
+		// (and the ones edited since), and the generation stamp each cell was last queued for evaluation at
+		vector<uint8_t> neighbors;
+		vector<int> flipped;
+		vector<uint32_t> queued;
+		uint32_t stamp;
+		// false after a bulk edit (a blit, a copy, many cells) - the counts are rebuilt on the next step
+		bool eventsValid;
+
+		Layout layout;
+		// MORTON layout: the cells in tiles, and the buffer of the next generation
+		MortonTiles tiles, spareTiles;
+		// the tiles are behind the rows after an edit, the rows behind the tiles after a step (never both)
+		bool tilesStale;
+		mutable bool rowsStale;
+
+		// edits from other threads, applied at the start of every step (not shared by copies)
+		EditQueue *edits;
+
+		// runs the tiles of step() (nullptr - the shared scheduler), shared by copies
+		TileScheduler *scheduler;
+
+		// summed-area table of live cells, (height+1)*(width+1), built on the first query after a change
+		mutable vector<uint32_t> counts;
+		mutable bool countsValid;
+
+		void changed();
+
+		void edited (const int, const int);
+
+		void sync() const;
+
+		void buildCounts() const;
+
+		void include (const int, const int, const int, const int);
+
+		void relocate (const int, const int, const int, const int);
+
+		void grow();
+
+		bool liveBounds (int &, int &, int &, int &) const;
+
+		long activity (const Tile &) const;
+
+		void stepTile (Matrix<bool> &, const Tile &) const;
+
+		void stepMorton();
+
+		long activity (const MortonTiles &, const Tile &) const;
+
+		void stepMortonTile (MortonTiles &, const int, const int, const Rules &) const;
+
+		void stepEvents();
+
+		TileScheduler &getScheduler() const;
+
+		void countNeighbors();
+
+		static Matrix<bool> neighborhood (const int);
+
+		static void fullAdd (const word, const word, const word, word &, word &);
+
+		static word bitOf (const int);
+
+		static void apply (word &, const word, const word, const Operation);
+
+		static void copyBits (const word *, const int, word *, const int, const int, const Operation);
 	public:
 		Board (const int, const unsigned int = DEFAULT_SURVIVAL, const unsigned int = DEFAULT_BIRTH);
 
 		Board (const int, const int, const unsigned int = DEFAULT_SURVIVAL, const unsigned int = DEFAULT_BIRTH);
 
+		Board (const Board &);
+
 		~Board();
 
-		const bool &operator() (const pair<int, int> &) const;
+		Board &operator= (const Board &);
+
+		bool operator() (const pair<int, int> &) const;
 
-		bool &operator() (const pair<int, int> &);
+		reference operator() (const pair<int, int> &);
 
-		const bool &operator() (const int, const int) const;
+		bool operator() (const int, const int) const;
 
-		bool &operator() (const int, const int);
+		reference operator() (const int, const int);
 
 		Board &toggle (const int, const int);
 
@@ -48,14 +190,67 @@ namespace Life {
 
 		Board &updateList (const std::list< std::pair< int, int > > &, const bool = true);
 
+		Board &update (const pair<int, int> *, const size_t, const Operation = SET);
+
+		Board &update (const vector<pair<int, int>> &, const Operation = SET);
+
+		Board &blit (const Matrix<bool> &, const int, const int, const Operation = COPY);
+
+		Board &blit (const Board &, const int, const int, const int, const int, const int, const int,
+		             const Operation = COPY);
+
 		Board &step();
 
+		Board &step (const long);
+
+		Board &setEdits (EditQueue *);
+
+		Board &setScheduler (TileScheduler *);
+
+		static bool parseRule (const string &, unsigned int &, unsigned int &);
+
+		string getRule() const;
+
+		bool isLinear() const;
+
+		Board &setStorage (const ::Matrix::PageResource::HugePages = ::Matrix::PageResource::NONE);
+
+		vector<int> getBandNodes() const;
+
+		Board &setEngine (const Engine);
+
+		Engine getEngine() const;
+
+		Board &setLayout (const Layout);
+
+		Layout getLayout() const;
+
+		long getChanges() const;
+
+		Board &setGrowth (const bool, const bool = false);
+
+		bool isGrowing() const;
+
+		Board &shrink();
+
 		Board &reset();
 
 		int getWidth() const;
 
+		long population() const;
+
+		long population (const int, const int, const int, const int) const;
+
+		uint64_t hash() const;
+
+		const Matrix<bool> &getCells() const;
+
 		int getHeight() const;
 
+		int getTop() const;
+
+		int getLeft() const;
+
 		friend ostream &operator<< (ostream &, const Board &);
 	};
 }
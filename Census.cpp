@@ -0,0 +1,560 @@
+#include "Census.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+namespace Life {
+	using std::endl;
+	using std::make_pair;
+	using std::max;
+	using std::min;
+
+	/**
+	 * @brief builds an empty census
+	 * @param seed the seed of the soups
+	 * @param threads soups run at once (0 - one per hardware thread)
+	 * @param soupSize the side of the random square
+	 * @param boardSize the side of the square it evolves in (spaceships leaving it are removed)
+	 * @param maxGenerations soups not repeating by then are counted as unstable
+	 **/
+	Census::Census (const uint64_t seed, const int threads, const int soupSize, const int boardSize,
+	                const long maxGenerations, const unsigned int survival, const unsigned int birth) : seed (seed),
+		threads (threads > 0 ? threads : max<int> (1, std::thread::hardware_concurrency())), soupSize (soupSize),
+		boardSize (max (boardSize, soupSize)), maxGenerations (maxGenerations), survival (survival), birth (birth),
+		soups (0), unstable (0), seconds (0) {
+	}
+
+	/**
+	 * @brief runs the next soups on all the threads and adds their objects to the census
+	 * @param count the number of soups
+	 * @return *this
+	 **/
+	Census &Census::run (const long count) {
+		auto start = std::chrono::steady_clock::now();
+		std::atomic<long> next (soups);
+		const long last = soups + count;
+		std::mutex merge;
+		auto worker = [this, &next, last, &merge] {
+			map<string, long> found;
+			long failed = 0;
+			for (long i = next++; i < last; i = next++) {
+				runSoup (i, found, failed);
+			}
+			std::lock_guard<std::mutex> lock (merge);
+			for (auto &object : found) {
+				objects[object.first] += object.second;
+			}
+			unstable += failed;
+		};
+		vector<std::thread> pool;
+		for (int i = 1; i < min<long> (threads, count); i++) {
+			pool.push_back (std::thread (worker));
+		}
+		worker();
+		for (auto &t : pool) {
+			t.join();
+		}
+		soups = last;
+		seconds += std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+		return *this;
+	}
+
+	/**
+	 * @brief runs a single soup to stability and counts its objects
+	 * @param index the soup number (selects its cells)
+	 * @param found the object counts to add to
+	 * @param failed incremented if the soup didn't stabilize
+	 **/
+	void Census::runSoup (const long index, map<string, long> &found, long &failed) const {
+		const int bits = Matrix<bool>::wordBits;
+		uint64_t state = seed + uint64_t (index) * 0x9E3779B97F4A7C15ULL;
+		Matrix<bool> soup (soupSize, soupSize);
+		for (int i = 0; i < soupSize; i++) {
+			Matrix<bool>::word *row = soup.rowWords (i);
+			for (int w = 0; w < soup.getStride(); w++) {
+				int used = min (bits, soupSize - w * bits);
+				row[w] = random (state) & (used == bits ? ~Matrix<bool>::word (0) : (Matrix<bool>::word (1) << used) - 1);
+			}
+		}
+		Board b (boardSize, boardSize, survival, birth);
+		b.blit (soup, (boardSize - soupSize) / 2, (boardSize - soupSize) / 2);
+		b.setGrowth (true, true);
+		const int period = settle (b, found);
+		if (period == 0) {
+			failed++;
+			return;
+		}
+		vector<Board> phases;
+		for (int p = 0; p < period; p++) {
+			phases.push_back (b);
+			b.step();
+		}
+		classify (phases, found);
+	}
+
+	/**
+	 * @brief steps the board until a generation repeats, removing the spaceships that escape
+	 * @param b the board (left at the first repeated generation)
+	 * @param found the object counts to add the spaceships to
+	 * @return the period, 0 if nothing repeated within maxGenerations
+	 **/
+	int Census::settle (Board &b, map<string, long> &found) const {
+		uint64_t history[CENSUS_MAX_PERIOD + 1];
+		set<Cells> stay;
+		for (long g = 0; g <= maxGenerations; g++) {
+			if (g > 0 && g % CENSUS_ESCAPE_INTERVAL == 0) {
+				removeShips (b, found, stay);
+			}
+			const uint64_t h = b.hash();
+			for (int p = 1; p <= min<long> (g, CENSUS_MAX_PERIOD); p++) {
+				if (history[ (g - p) % (CENSUS_MAX_PERIOD + 1)] == h) {
+					return p;
+				}
+			}
+			history[g % (CENSUS_MAX_PERIOD + 1)] = h;
+			// most of a large board is settled ash: the event engine only looks at what changes
+			const Board::Engine engine = long (b.getHeight()) * b.getWidth() > CENSUS_EVENT_CELLS ? Board::EVENTS : Board::TILED;
+			if (b.getEngine() != engine) {
+				b.setEngine (engine);
+			}
+			b.step();
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief takes the spaceships outside the soup's square with nothing in their way off the board
+	 * (objects with a cell outside the square are tried, up to CENSUS_MAX_SHIP cells)
+	 * @param b the board
+	 * @param found the object counts to add the spaceships to
+	 * @param stay the objects found not to be spaceships (not tried again)
+	 **/
+	void Census::removeShips (Board &b, map<string, long> &found, set<Cells> &stay) const {
+		const int top = b.getTop(), left = b.getLeft();
+		const int height = b.getHeight(), width = b.getWidth();
+		if (top >= 0 && left >= 0 && top + height <= boardSize && left + width <= boardSize) {
+			return;
+		}
+		Cells live, component, pending, removed;
+		liveCells (b, live);
+		const Matrix<bool> &cells = b.getCells();
+		vector<char> seen (size_t (height) * width, 0);
+		// the spaceships found, their phases and moves per period, and the one each cell belongs to (or -1)
+		vector<Cells> ships;
+		vector<vector<Cells>> phases;
+		vector<pair<int, int>> moves;
+		vector<int> owner (size_t (height) * width, -1);
+		vector<Cells> shapes;
+		for (auto &start : live) {
+			const int i = start.first - top, j = start.second - left;
+			if (seen[size_t (i) * width + j] || (start.first >= 0 && start.first < boardSize && start.second >= 0
+			                                     && start.second < boardSize)) {
+				continue;
+			}
+			// flood fill the 8-connected object (of this generation), giving up on large ones
+			component.clear();
+			pending.assign (1, make_pair (i, j));
+			seen[size_t (i) * width + j] = 1;
+			while (!pending.empty() && component.size() <= CENSUS_MAX_SHIP) {
+				pair<int, int> cell = pending.back();
+				pending.pop_back();
+				component.push_back (make_pair (top + cell.first, left + cell.second));
+				for (int r = max (cell.first - 1, 0); r <= min (cell.first + 1, height - 1); r++) {
+					for (int c = max (cell.second - 1, 0); c <= min (cell.second + 1, width - 1); c++) {
+						if (!seen[size_t (r) * width + c] && cells (r, c)) {
+							seen[size_t (r) * width + c] = 1;
+							pending.push_back (make_pair (r, c));
+						}
+					}
+				}
+			}
+			if (!pending.empty()) {
+				continue;
+			}
+			std::sort (component.begin(), component.end());
+			int dr, dc;
+			if (stay.count (component) != 0) {
+				continue;
+			}
+			if (!isShip (component, shapes, dr, dc)) {
+				stay.insert (component);
+				continue;
+			}
+			for (auto &cell : component) {
+				owner[size_t (cell.first - top) * width + cell.second - left] = ships.size();
+			}
+			ships.push_back (component);
+			phases.push_back (shapes);
+			moves.push_back (make_pair (dr, dc));
+		}
+		vector<bool> taken (ships.size(), false);
+		for (size_t s = 0; s < ships.size(); s++) {
+			const int dr = moves[s].first, dc = moves[s].second;
+			// cells that can't get in its way: its own, those of the spaceships flying with it
+			// (they never meet) and of the ones already taken off
+			auto other = [&] (const int r, const int c) {
+				const int ship = owner[size_t (r - top) * width + c - left];
+				return ship < 0 || (moves[ship] != moves[s] && !taken[ship]);
+			};
+			// nothing in its way: no other live cell within 2 cells of it, and none level with
+			// or ahead of it within 2 cells of its path (along and across its direction, scaled by it)
+			bool clear = true;
+			for (auto &cell : ships[s]) {
+				for (int r = max (cell.first - 2, top); r <= min (cell.first + 2, top + height - 1) && clear; r++) {
+					for (int c = max (cell.second - 2, left); c <= min (cell.second + 2, left + width - 1) && clear; c++) {
+						clear = !cells (r - top, c - left) || !other (r, c);
+					}
+				}
+			}
+			const long reach = 2L * (std::abs (dr) + std::abs (dc));
+			long from = LONG_MAX, low = LONG_MAX, high = LONG_MIN;
+			for (auto &cell : ships[s]) {
+				from = min (from, long (cell.first) * dr + long (cell.second) * dc);
+				low = min (low, long (cell.first) * dc - long (cell.second) * dr);
+				high = max (high, long (cell.first) * dc - long (cell.second) * dr);
+			}
+			for (size_t k = 0; k < live.size() && clear; k++) {
+				const long along = long (live[k].first) * dr + long (live[k].second) * dc;
+				const long across = long (live[k].first) * dc - long (live[k].second) * dr;
+				clear = along < from || across < low - reach || across > high + reach || !other (live[k].first, live[k].second);
+			}
+			if (clear) {
+				taken[s] = true;
+				found[canonical (phases[s], phases[s].size(), true)]++;
+				removed.insert (removed.end(), ships[s].begin(), ships[s].end());
+			}
+		}
+		if (!removed.empty()) {
+			b.update (removed, Board::CLEAR);
+		}
+	}
+
+	/**
+	 * @brief checks if an object, run on its own, is a spaceship
+	 * @param cells the cells of the object, sorted
+	 * @param shapes set to the cells of the phases of its period
+	 * @param dr set to the rows it moves by in a period
+	 * @param dc set to the columns it moves by in a period
+	 * @return true if it comes back translated within CENSUS_MAX_PERIOD generations
+	 **/
+	bool Census::isShip (const Cells &cells, vector<Cells> &shapes, int &dr, int &dc) const {
+		int top = cells[0].first, left = cells[0].second, bottom = top, right = left;
+		for (auto &cell : cells) {
+			top = min (top, cell.first);
+			bottom = max (bottom, cell.first);
+			left = min (left, cell.second);
+			right = max (right, cell.second);
+		}
+		// no spaceship is faster than c/2
+		const int margin = CENSUS_MAX_PERIOD / 2 + 2;
+		Board alone (bottom - top + 1 + 2 * margin, right - left + 1 + 2 * margin, survival, birth);
+		Cells shape;
+		for (auto &cell : cells) {
+			shape.push_back (make_pair (cell.first - top + margin, cell.second - left + margin));
+		}
+		alone.update (shape);
+		const Board first = alone;
+		vector<uint64_t> history;
+		for (int p = 1; p <= CENSUS_MAX_PERIOD; p++) {
+			// debris settling in place is no spaceship
+			const uint64_t h = alone.step().hash();
+			if (std::find (history.begin(), history.end(), h) != history.end()) {
+				return false;
+			}
+			history.push_back (h);
+			// only a generation of the same population can be a (translated) copy
+			const long population = alone.population();
+			if (population == 0) {
+				return false;
+			}
+			if (population != long (cells.size())) {
+				continue;
+			}
+			liveCells (alone, shape);
+			bool same = true;
+			for (size_t k = 0; k < cells.size() && same; k++) {
+				same = shape[k].first - shape[0].first == cells[k].first - cells[0].first
+				       && shape[k].second - shape[0].second == cells[k].second - cells[0].second;
+			}
+			if (!same) {
+				continue;
+			}
+			dr = shape[0].first - margin + top - cells[0].first;
+			dc = shape[0].second - margin + left - cells[0].second;
+			if (dr == 0 && dc == 0) {
+				// a still life or an oscillator
+				return false;
+			}
+			Board phase = first;
+			shapes.assign (1, cells);
+			for (int k = 1; k < p; k++) {
+				liveCells (phase.step(), shape);
+				shapes.push_back (shape);
+			}
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * @brief lists the live cells of a board, a word at a time
+	 * @param b the board
+	 * @param cells set to the live cells, sorted
+	 **/
+	void Census::liveCells (const Board &b, Cells &cells) {
+		const int bits = Matrix<bool>::wordBits;
+		const Matrix<bool> &live = b.getCells();
+		cells.clear();
+		for (int i = 0; i < live.getHeight(); i++) {
+			const Matrix<bool>::word *row = live.rowWords (i);
+			for (int w = 0; w < live.getStride(); w++) {
+				for (Matrix<bool>::word word = row[w]; word != 0; word &= word - 1) {
+					cells.push_back (make_pair (b.getTop() + i, b.getLeft() + w * bits + __builtin_ctzll (word)));
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief splits the phases of a periodic board into objects and counts them
+	 * @param phases the generations of one period
+	 * @param found the object counts to add to
+	 **/
+	void Census::classify (const vector<Board> &phases, map<string, long> &found) {
+		const int height = phases[0].getHeight();
+		const int width = phases[0].getWidth();
+		// a growing board doesn't grow (or move) while it repeats
+		const int top = phases[0].getTop(), left = phases[0].getLeft();
+		const int period = phases.size();
+		// 1 - alive in some phase, 2 - already part of an object
+		vector<char> cells (size_t (height) * width, 0);
+		for (const Board &b : phases) {
+			for (int i = 0; i < height; i++) {
+				for (int j = 0; j < width; j++) {
+					if (b (top + i, left + j)) {
+						cells[size_t (i) * width + j] = 1;
+					}
+				}
+			}
+		}
+		Cells component, pending;
+		for (int i = 0; i < height; i++) {
+			for (int j = 0; j < width; j++) {
+				if (cells[size_t (i) * width + j] != 1) {
+					continue;
+				}
+				// flood fill the 8-connected object
+				component.clear();
+				pending.assign (1, make_pair (i, j));
+				cells[size_t (i) * width + j] = 2;
+				while (!pending.empty()) {
+					pair<int, int> cell = pending.back();
+					pending.pop_back();
+					component.push_back (cell);
+					for (int r = max (cell.first - 1, 0); r <= min (cell.first + 1, height - 1); r++) {
+						for (int c = max (cell.second - 1, 0); c <= min (cell.second + 1, width - 1); c++) {
+							if (cells[size_t (r) * width + c] == 1) {
+								cells[size_t (r) * width + c] = 2;
+								pending.push_back (make_pair (r, c));
+							}
+						}
+					}
+				}
+				std::sort (component.begin(), component.end());
+				vector<Cells> shapes (period);
+				for (int p = 0; p < period; p++) {
+					for (auto &cell : component) {
+						if (phases[p] (top + cell.first, left + cell.second)) {
+							shapes[p].push_back (cell);
+						}
+					}
+				}
+				// the object's own period divides the board's
+				int own = 1;
+				while (own < period && (period % own != 0 || shapes[own] != shapes[0])) {
+					own++;
+				}
+				shapes.resize (own);
+				found[canonical (shapes, own)]++;
+			}
+		}
+	}
+
+	/**
+	 * @brief returns the apgcode of an object
+	 * @param shapes the cells of the object in each phase
+	 * @param period the period of the object
+	 * @param moving true for a spaceship
+	 * @return the code
+	 **/
+	string Census::canonical (const vector<Cells> &shapes, const int period, const bool moving) {
+		string best;
+		Cells cells;
+		for (const Cells &shape : shapes) {
+			for (int symmetry = 0; symmetry < 8; symmetry++) {
+				cells.clear();
+				for (auto &cell : shape) {
+					int r = (symmetry & 1) ? -cell.first : cell.first;
+					int c = (symmetry & 2) ? -cell.second : cell.second;
+					cells.push_back ( (symmetry & 4) ? make_pair (c, r) : make_pair (r, c));
+				}
+				string code = wechsler (cells);
+				if (best.empty() || code.size() < best.size() || (code.size() == best.size() && code < best)) {
+					best = code;
+				}
+			}
+		}
+		if (moving) {
+			return "xq" + std::to_string (period) + "_" + best;
+		}
+		if (period == 1) {
+			return "xs" + std::to_string (shapes[0].size()) + "_" + best;
+		}
+		return "xp" + std::to_string (period) + "_" + best;
+	}
+
+	/**
+	 * @brief encodes cells in the extended Wechsler format:
+	 * strips of 5 rows, a character (0-9, a-v) per column of a strip with the top row as bit 0,
+	 * strips separated by z, trailing zeros dropped and runs of zeros shortened (w - 00, x - 000, y? - 4 to 39)
+	 * @param cells the cells (any translation)
+	 * @return the code
+	 **/
+	string Census::wechsler (const Cells &cells) {
+		static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+		int top = cells[0].first, left = cells[0].second, bottom = top, right = left;
+		for (auto &cell : cells) {
+			top = min (top, cell.first);
+			bottom = max (bottom, cell.first);
+			left = min (left, cell.second);
+			right = max (right, cell.second);
+		}
+		const int strips = (bottom - top) / 5 + 1;
+		const int width = right - left + 1;
+		vector<int> columns (size_t (strips) * width, 0);
+		for (auto &cell : cells) {
+			int r = cell.first - top;
+			columns[size_t (r / 5) * width + cell.second - left] |= 1 << (r % 5);
+		}
+		string ret;
+		for (int s = 0; s < strips; s++) {
+			if (s > 0) {
+				ret += 'z';
+			}
+			const int *strip = &columns[size_t (s) * width];
+			int end = width;
+			while (end > 0 && strip[end - 1] == 0) {
+				end--;
+			}
+			for (int j = 0; j < end;) {
+				if (strip[j] != 0) {
+					ret += digits[strip[j++]];
+					continue;
+				}
+				int zeros = 0;
+				while (j < end && strip[j] == 0 && zeros < 39) {
+					zeros++;
+					j++;
+				}
+				if (zeros == 1) {
+					ret += '0';
+				} else if (zeros == 2) {
+					ret += 'w';
+				} else if (zeros == 3) {
+					ret += 'x';
+				} else {
+					ret += 'y';
+					ret += digits[zeros - 4];
+				}
+			}
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief splitmix64 - returns the next number of the sequence
+	 * @param state the generator state
+	 * @return 64 random bits
+	 **/
+	uint64_t Census::random (uint64_t &state) {
+		uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	long Census::getSoups() const {
+		return soups;
+	}
+
+	/**
+	 * @brief returns the number of soups that didn't stabilize
+	 * @return unstable soups
+	 **/
+	long Census::getUnstable() const {
+		return unstable;
+	}
+
+	/**
+	 * @brief returns the number of spaceships that escaped the soups
+	 * @return spaceships (the xq objects)
+	 **/
+	long Census::getSpaceships() const {
+		long ret = 0;
+		for (auto &object : objects) {
+			if (object.first.compare (0, 2, "xq") == 0) {
+				ret += object.second;
+			}
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief returns the time spent running soups
+	 * @return seconds
+	 **/
+	double Census::getSeconds() const {
+		return seconds;
+	}
+
+	/**
+	 * @brief returns the throughput
+	 * @return soups per second
+	 **/
+	double Census::getSoupsPerSecond() const {
+		return seconds > 0 ? soups / seconds : 0;
+	}
+
+	/**
+	 * @brief returns the object counts
+	 * @return apgcode -> occurrences
+	 **/
+	const map<string, long> &Census::getObjects() const {
+		return objects;
+	}
+
+	/**
+	 * @brief prints the census - a summary line, then the objects, most common first
+	 * @param os the stream
+	 * @param census the census
+	 * @return os
+	 **/
+	ostream &operator<< (ostream &os, const Census &census) {
+		os << census.soups << " soups (" << census.unstable << " unstable, " << census.getSpaceships()
+		   << " spaceships) in " << census.seconds << " s, "
+		   << census.getSoupsPerSecond() << " soups/sec" << endl;
+		vector<pair<long, string>> sorted;
+		for (auto &object : census.objects) {
+			sorted.push_back (make_pair (-object.second, object.first));
+		}
+		std::sort (sorted.begin(), sorted.end());
+		for (auto &object : sorted) {
+			os << object.second << " " << -object.first << endl;
+		}
+		return os;
+	}
+}
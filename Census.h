@@ -0,0 +1,95 @@
+#ifndef _CENSUS_H_
+#define _CENSUS_H_
+#include "Board.h"
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// default census parameters
+#define DEFAULT_SOUP_SIZE 16
+#define DEFAULT_CENSUS_BOARD_SIZE 64
+#define DEFAULT_MAX_GENERATIONS 6000
+// longest period recognized as stable (or as a spaceship's)
+#define CENSUS_MAX_PERIOD 30
+// generations between looks for spaceships that left the soup's square, and the largest one looked for
+#define CENSUS_ESCAPE_INTERVAL 30
+#define CENSUS_MAX_SHIP 64
+// boards of more cells are stepped by the event engine
+#define CENSUS_EVENT_CELLS 16384
+
+namespace Life {
+	using std::map;
+	using std::ostream;
+	using std::pair;
+	using std::set;
+	using std::string;
+	using std::vector;
+
+	/**
+	 * random soup census
+	 * every soup is a random soupSize*soupSize square (seeded by the census seed and the soup number,
+	 * so results don't depend on the thread count) in the middle of a boardSize*boardSize square
+	 * of a growing board. spaceships outside the square with nothing left ahead of them are taken
+	 * off the board (and counted) as they go. the soup is run until a generation repeats, and the
+	 * ash is split into objects (8-connected over all the phases of the period). objects are counted by their
+	 * apgcode: xs<population>_ for still lifes, xp<period>_ for oscillators, xq<period>_ for
+	 * spaceships, followed by the extended Wechsler code - the shortest (then lowest) over all
+	 * phases and the 8 symmetries.
+	 **/
+	class Census {
+		typedef vector<pair<int, int>> Cells;
+
+		uint64_t seed;
+		int threads, soupSize, boardSize;
+		long maxGenerations;
+		unsigned int survival, birth;
+
+		long soups, unstable;
+		double seconds;
+		map<string, long> objects;
+
+		void runSoup (const long, map<string, long> &, long &) const;
+
+		int settle (Board &, map<string, long> &) const;
+
+		void removeShips (Board &, map<string, long> &, set<Cells> &) const;
+
+		bool isShip (const Cells &, vector<Cells> &, int &, int &) const;
+
+		static void liveCells (const Board &, Cells &);
+
+		static void classify (const vector<Board> &, map<string, long> &);
+
+		static string canonical (const vector<Cells> &, const int, const bool = false);
+
+		static string wechsler (const Cells &);
+
+		static uint64_t random (uint64_t &);
+	public:
+		Census (const uint64_t, const int = 0, const int = DEFAULT_SOUP_SIZE, const int = DEFAULT_CENSUS_BOARD_SIZE,
+		        const long = DEFAULT_MAX_GENERATIONS, const unsigned int = DEFAULT_SURVIVAL,
+		        const unsigned int = DEFAULT_BIRTH);
+
+		Census &run (const long);
+
+		long getSoups() const;
+
+		long getUnstable() const;
+
+		long getSpaceships() const;
+
+		double getSeconds() const;
+
+		double getSoupsPerSecond() const;
+
+		const map<string, long> &getObjects() const;
+
+		friend ostream &operator<< (ostream &, const Census &);
+	};
+}
+
+#endif
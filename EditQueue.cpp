@@ -0,0 +1,147 @@
+#include "EditQueue.h"
+#include <algorithm>
+#include <utility>
+
+namespace Life {
+	using std::memory_order_acquire;
+	using std::memory_order_acq_rel;
+	using std::memory_order_relaxed;
+	using std::memory_order_release;
+
+	EditQueue::EditQueue() : tail (&stub), head (&stub), edits (0), rejected (0), batches (0), totalLatency (0),
+		maxLatency (0) {
+		stub.next.store (nullptr, memory_order_relaxed);
+	}
+
+	EditQueue::~EditQueue() {
+		Edit *edit;
+		while ( (edit = pop()) != nullptr) {
+			delete edit;
+		}
+	}
+
+	/**
+	 * @brief queues cells to update (any thread)
+	 * @param cells the coordinates (as Board::update)
+	 * @param operation what to do to them
+	 * @return *this
+	 **/
+	EditQueue &EditQueue::submit (vector<pair<int, int>> cells, const Board::Operation operation) {
+		Edit *edit = new Edit;
+		edit->cells = std::move (cells);
+		edit->operation = operation;
+		edit->submitted = clock::now();
+		push (edit);
+		return *this;
+	}
+
+	/**
+	 * @brief queues a single cell to update (any thread)
+	 * @param r row
+	 * @param c column
+	 * @param operation what to do to it (toggles by default, as Board::toggle)
+	 * @return *this
+	 **/
+	EditQueue &EditQueue::submit (const int r, const int c, const Board::Operation operation) {
+		return submit (vector<pair<int, int>> (1, std::make_pair (r, c)), operation);
+	}
+
+	/**
+	 * @brief applies the edits queued so far, oldest first (the consumer - the stepping thread)
+	 * an edit reaching out of a fixed board is dropped as a whole (and counted as rejected)
+	 * @param b the board
+	 * @return the number of edits applied
+	 **/
+	long EditQueue::apply (Board &b) {
+		// edits queued after this one wait for the next generation
+		const Edit *last = tail.load (memory_order_acquire);
+		if (last == &stub && head == &stub) {
+			return 0;
+		}
+		const clock::time_point now = clock::now();
+		long count = 0;
+		Edit *edit;
+		while ( (edit = pop()) != nullptr) {
+			try {
+				b.update (edit->cells, edit->operation);
+				count++;
+			} catch (const ::Matrix::OutOfBounds &) {
+				rejected.fetch_add (1, memory_order_relaxed);
+			}
+			const int64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds> (now - edit->submitted).count();
+			totalLatency.fetch_add (latency, memory_order_relaxed);
+			if (latency > maxLatency.load (memory_order_relaxed)) {
+				maxLatency.store (latency, memory_order_relaxed);
+			}
+			const bool done = edit == last;
+			delete edit;
+			if (done) {
+				break;
+			}
+		}
+		if (count > 0) {
+			edits.fetch_add (count, memory_order_relaxed);
+			batches.fetch_add (1, memory_order_relaxed);
+		}
+		return count;
+	}
+
+	/**
+	 * @brief returns the counters (a snapshot when called concurrently)
+	 * @return the statistics
+	 **/
+	EditQueue::Statistics EditQueue::getStatistics() const {
+		Statistics s;
+		s.edits = edits.load (memory_order_relaxed);
+		s.rejected = rejected.load (memory_order_relaxed);
+		s.batches = batches.load (memory_order_relaxed);
+		const long applied = s.edits + s.rejected;
+		s.meanLatency = applied > 0 ? totalLatency.load (memory_order_relaxed) * 1e-9 / applied : 0;
+		s.maxLatency = maxLatency.load (memory_order_relaxed) * 1e-9;
+		return s;
+	}
+
+	/**
+	 * @brief links an edit as the new tail (any thread)
+	 * between the swap and the link the edit (and those after it) can't be popped yet
+	 * @param edit the edit
+	 **/
+	void EditQueue::push (Edit *edit) {
+		edit->next.store (nullptr, memory_order_relaxed);
+		Edit *previous = tail.exchange (edit, memory_order_acq_rel);
+		previous->next.store (edit, memory_order_release);
+	}
+
+	/**
+	 * @brief unlinks the oldest edit (consumer only)
+	 * @return the edit, nullptr if there is none (or the next one is still being linked)
+	 **/
+	EditQueue::Edit *EditQueue::pop() {
+		Edit *first = head;
+		Edit *next = first->next.load (memory_order_acquire);
+		if (first == &stub) {
+			if (next == nullptr) {
+				return nullptr;
+			}
+			head = next;
+			first = next;
+			next = next->next.load (memory_order_acquire);
+		}
+		if (next != nullptr) {
+			head = next;
+			return first;
+		}
+		if (first != tail.load (memory_order_acquire)) {
+			// a producer is between its swap and its link
+			return nullptr;
+		}
+		// the last edit - put the stub behind it so it can be unlinked
+		push (&stub);
+		next = first->next.load (memory_order_acquire);
+		if (next != nullptr) {
+			head = next;
+			return first;
+		}
+		return nullptr;
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef _EDIT_QUEUE_H_
+#define _EDIT_QUEUE_H_
+#include "Board.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Life {
+	using std::pair;
+	using std::vector;
+
+	/**
+	 * multi-producer/single-consumer lock-free queue of cell edits
+	 * any thread may submit edits while the board steps on another one. a board with the queue set
+	 * (Board::setEdits) applies them at the start of every step(), in the order they were queued,
+	 * each edit as a whole. an apply takes only the edits queued before it started, so a flood of
+	 * edits can't stall the simulation. the time from submit to apply is measured.
+	 * (an intrusive linked list - a producer swaps itself in as the tail, the consumer walks from the head)
+	 **/
+	class EditQueue {
+	public:
+		struct Statistics {
+			// edits applied, rejected (out of a fixed board), and the generations that applied any
+			long edits, rejected, batches;
+			// from submit to apply, in seconds
+			double meanLatency, maxLatency;
+		};
+	private:
+		typedef std::chrono::steady_clock clock;
+
+		enum { CACHE_LINE = 64 };
+
+		struct Edit {
+			std::atomic<Edit *> next;
+			vector<pair<int, int>> cells;
+			Board::Operation operation;
+			clock::time_point submitted;
+		};
+
+		// the last edit (swapped by the producers)
+		std::atomic<Edit *> tail;
+		char padding0[CACHE_LINE - sizeof (std::atomic<Edit *>)];
+		// the next edit to apply (consumer only), and the placeholder that keeps the list non-empty
+		Edit *head;
+		Edit stub;
+
+		std::atomic<long> edits, rejected, batches;
+		// nanoseconds
+		std::atomic<int64_t> totalLatency, maxLatency;
+
+		void push (Edit *);
+
+		Edit *pop();
+	public:
+		EditQueue();
+
+		~EditQueue();
+
+		EditQueue (const EditQueue &) = delete;
+		EditQueue &operator= (const EditQueue &) = delete;
+
+		EditQueue &submit (vector<pair<int, int>>, const Board::Operation = Board::SET);
+
+		EditQueue &submit (const int, const int, const Board::Operation = Board::TOGGLE);
+
+		long apply (Board &);
+
+		Statistics getStatistics() const;
+	};
+}
+
+#endif
@@ -0,0 +1,396 @@
+#include "Exporter.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <system_error>
+
+namespace Life {
+	using std::lock_guard;
+	using std::mutex;
+	using std::unique_lock;
+
+	/**
+	 * @brief builds an exporter and starts its workers
+	 * @param target the file name prefix (FILES) or the file name (SEQUENCE)
+	 * @param format PBM or PGM
+	 * @param layout a file per frame or a single file
+	 * @param threads workers (0 - all hardware threads but the simulation's)
+	 * @param capacity frames outstanding before submit() waits
+	 **/
+	Exporter::Exporter (const string &target, const Format format, const Layout layout, const int threads,
+	                    const size_t capacity) : target (target), format (format), layout (layout), view {1, 1, 0, 0, 0, 0},
+		capacity (std::max<size_t> (capacity, 1)), outstanding (0), nextWrite (0), closing (false), submitted (0),
+		written (0), stalls (0), bytes (0) {
+		if (layout == SEQUENCE) {
+			sequence.open (target, std::ios::binary | std::ios::trunc);
+			if (!sequence) {
+				throw std::system_error (errno, std::generic_category(), target);
+			}
+		}
+		const int count = threads > 0 ? threads : std::max<int> (1, int (std::thread::hardware_concurrency()) - 1);
+		for (int i = 0; i < count; i++) {
+			workers.push_back (std::thread (&Exporter::work, this));
+		}
+	}
+
+	Exporter::~Exporter() {
+		try {
+			finish();
+		} catch (...) {
+			// reported by finish() to those who call it
+		}
+		{
+			lock_guard<mutex> guard (lock);
+			closing = true;
+		}
+		queued.notify_all();
+		for (auto &t : workers) {
+			t.join();
+		}
+		for (Frame *frame : spare) {
+			delete frame;
+		}
+	}
+
+	/**
+	 * @brief sets the size of a cell in pixels, for the frames submitted from now on
+	 * @param scale pixels per cell side
+	 * @return *this
+	 **/
+	Exporter &Exporter::setScale (const int scale) {
+		view.scale = std::max (scale, 1);
+		return *this;
+	}
+
+	/**
+	 * @brief sets the cells per pixel, for the frames submitted from now on
+	 * (PGM shows the density of the shrink*shrink block, PBM a pixel if any cell lives)
+	 * @param shrink cells per pixel side
+	 * @return *this
+	 **/
+	Exporter &Exporter::setShrink (const int shrink) {
+		view.shrink = std::max (shrink, 1);
+		return *this;
+	}
+
+	/**
+	 * @brief exports only a part of the board, for the frames submitted from now on
+	 * cells outside the board are dead, a height or width of 0 exports the whole board
+	 * @param row the top row (in board coordinates)
+	 * @param column the left column
+	 * @param height rows
+	 * @param width columns
+	 * @return *this
+	 **/
+	Exporter &Exporter::setCrop (const int row, const int column, const int height, const int width) {
+		view.row = row;
+		view.column = column;
+		view.height = height > 0 && width > 0 ? height : 0;
+		view.width = height > 0 && width > 0 ? width : 0;
+		return *this;
+	}
+
+	/**
+	 * @brief queues the board as the next frame (waits while the queue is full)
+	 * rethrows a failure of the workers
+	 * @param b the board
+	 * @return *this
+	 **/
+	Exporter &Exporter::submit (const Board &b) {
+		Frame *frame = nullptr;
+		{
+			unique_lock<mutex> guard (lock);
+			if (outstanding >= capacity) {
+				stalls++;
+				freed.wait (guard, [this] {
+					return outstanding < capacity || error;
+				});
+			}
+			if (error) {
+				std::rethrow_exception (error);
+			}
+			outstanding++;
+			if (!spare.empty()) {
+				frame = spare.back();
+				spare.pop_back();
+			}
+		}
+		if (frame == nullptr) {
+			frame = new Frame;
+		}
+		// the copy is the only work on the simulation thread (it shares the bands of the cells)
+		frame->cells = b.getCells();
+		frame->top = b.getTop();
+		frame->left = b.getLeft();
+		frame->number = submitted++;
+		frame->view = view;
+		{
+			lock_guard<mutex> guard (lock);
+			pending.push_back (frame);
+		}
+		queued.notify_one();
+		return *this;
+	}
+
+	/**
+	 * @brief exports the board and the given number of generations after it
+	 * @param b the board to advance
+	 * @param generations the number of steps
+	 * @return *this
+	 **/
+	Exporter &Exporter::run (Board &b, const long generations) {
+		submit (b);
+		for (long i = 0; i < generations; i++) {
+			b.step();
+			submit (b);
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief waits until every submitted frame is written
+	 * rethrows the first failure of the workers (the frames after it are discarded)
+	 **/
+	void Exporter::finish() {
+		unique_lock<mutex> guard (lock);
+		freed.wait (guard, [this] {
+			return outstanding == 0;
+		});
+		if (sequence.is_open()) {
+			sequence.flush();
+			if (!sequence && !error) {
+				error = std::make_exception_ptr (std::system_error (errno, std::generic_category(), target));
+			}
+		}
+		if (error) {
+			std::rethrow_exception (error);
+		}
+	}
+
+	/**
+	 * @brief a worker - encodes and writes the queued frames
+	 **/
+	void Exporter::work() {
+		vector<char> image;
+		while (true) {
+			Frame *frame;
+			bool failed;
+			{
+				unique_lock<mutex> guard (lock);
+				queued.wait (guard, [this] {
+					return closing || !pending.empty();
+				});
+				if (pending.empty()) {
+					return;
+				}
+				frame = pending.front();
+				pending.pop_front();
+				failed = bool (error);
+			}
+			try {
+				if (!failed) {
+					encode (*frame, image);
+				}
+				write (*frame, image);
+			} catch (...) {
+				lock_guard<mutex> guard (lock);
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+			{
+				lock_guard<mutex> guard (lock);
+				spare.push_back (frame);
+				outstanding--;
+			}
+			freed.notify_all();
+		}
+	}
+
+	/**
+	 * @brief gets 64 cells of a row (dead outside the board)
+	 * @param row the words of the row (nullptr - a row outside the board)
+	 * @param words the words of a row
+	 * @param column the first column, bit 0 of the result
+	 * @return the cells
+	 **/
+	static uint64_t cellsAt (const uint64_t *row, const int words, const int column) {
+		if (row == nullptr) {
+			return 0;
+		}
+		const int w = column >= 0 ? column / 64 : - ( (63 - column) / 64);
+		const int shift = column - w * 64;
+		const uint64_t low = w >= 0 && w < words ? row[w] : 0;
+		const uint64_t high = w + 1 >= 0 && w + 1 < words ? row[w + 1] : 0;
+		return shift == 0 ? low : low >> shift | high << (64 - shift);
+	}
+
+	/**
+	 * @brief reverses the bits of a byte (cells are stored least significant first, PBM pixels most)
+	 * @param b the byte
+	 * @return the reversed byte
+	 **/
+	static unsigned char reverse (unsigned b) {
+		b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+		b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+		return (b & 0xAA) >> 1 | (b & 0x55) << 1;
+	}
+
+	/**
+	 * @brief renders a frame as a netpbm image (header and raster)
+	 * @param frame the frame
+	 * @param image the image
+	 **/
+	void Exporter::encode (const Frame &frame, vector<char> &image) const {
+		const View &v = frame.view;
+		const Matrix<bool> &cells = frame.cells;
+		const int words = cells.getStride();
+		// the area in the coordinates of the cells
+		const int row0 = v.height > 0 ? v.row - frame.top : 0;
+		const int column0 = v.width > 0 ? v.column - frame.left : 0;
+		const int height = v.height > 0 ? v.height : cells.getHeight();
+		const int width = v.width > 0 ? v.width : cells.getWidth();
+		const int pixelRows = (height + v.shrink - 1) / v.shrink;
+		const int pixelColumns = (width + v.shrink - 1) / v.shrink;
+		const int imageWidth = pixelColumns * v.scale;
+		const int imageHeight = pixelRows * v.scale;
+		const size_t rowBytes = format == PBM ? (imageWidth + 7) / 8 : imageWidth;
+		char header[64];
+		const int headerBytes = std::snprintf (header, sizeof (header), format == PBM ? "P4\n%d %d\n" : "P5\n%d %d\n255\n",
+		                                       imageWidth, imageHeight);
+		image.assign (header, header + headerBytes);
+		image.resize (headerBytes + rowBytes * imageHeight);
+		char *out = image.data() + headerBytes;
+		// live cells per pixel of the current pixel row
+		vector<int> counts (pixelColumns);
+		for (int y = 0; y < pixelRows; y++) {
+			char *line = out + size_t (y) * v.scale * rowBytes;
+			if (format == PBM && v.scale == 1 && v.shrink == 1) {
+				// a pixel per cell - 64 at a time
+				const int r = row0 + y;
+				const uint64_t *row = r >= 0 && r < cells.getHeight() ? cells.rowWords (r) : nullptr;
+				for (int x = 0; x < width; x += 64) {
+					uint64_t bits = cellsAt (row, words, column0 + x);
+					if (width - x < 64) {
+						bits &= (uint64_t (1) << (width - x)) - 1;
+					}
+					for (int k = 0; k < 8 && x + 8 * k < width; k++) {
+						line[x / 8 + k] = char (reverse ( (bits >> (8 * k)) & 0xFF));
+					}
+				}
+				continue;
+			}
+			std::fill (counts.begin(), counts.end(), 0);
+			for (int r = row0 + y * v.shrink; r < std::min (row0 + (y + 1) * v.shrink, row0 + height); r++) {
+				if (r < 0 || r >= cells.getHeight()) {
+					continue;
+				}
+				const uint64_t *row = cells.rowWords (r);
+				for (int x = 0; x < width; x += 64) {
+					uint64_t bits = cellsAt (row, words, column0 + x);
+					if (width - x < 64) {
+						bits &= (uint64_t (1) << (width - x)) - 1;
+					}
+					for (; bits != 0; bits &= bits - 1) {
+						counts[ (x + __builtin_ctzll (bits)) / v.shrink]++;
+					}
+				}
+			}
+			if (format == PBM) {
+				std::fill (line, line + rowBytes, 0);
+				for (int x = 0; x < imageWidth; x++) {
+					if (counts[x / v.scale] > 0) {
+						line[x / 8] |= char (0x80 >> (x % 8));
+					}
+				}
+			} else {
+				const int area = v.shrink * v.shrink;
+				for (int x = 0; x < pixelColumns; x++) {
+					std::fill (line + x * v.scale, line + (x + 1) * v.scale, char (255 - 255 * counts[x] / area));
+				}
+			}
+			for (int i = 1; i < v.scale; i++) {
+				std::copy (line, line + rowBytes, line + i * rowBytes);
+			}
+		}
+	}
+
+	/**
+	 * @brief writes an encoded frame to its file, or in turn to the sequence
+	 * (a frame after a failure is skipped, but still takes its turn)
+	 * @param frame the frame
+	 * @param image the encoded frame
+	 **/
+	void Exporter::write (const Frame &frame, const vector<char> &image) {
+		if (layout == FILES) {
+			{
+				lock_guard<mutex> guard (lock);
+				if (error) {
+					return;
+				}
+			}
+			char number[24];
+			std::snprintf (number, sizeof (number), "%06ld", frame.number);
+			const string name = target + number + (format == PBM ? ".pbm" : ".pgm");
+			std::ofstream file (name, std::ios::binary | std::ios::trunc);
+			file.write (image.data(), image.size());
+			file.close();
+			if (!file) {
+				throw std::system_error (errno, std::generic_category(), name);
+			}
+		} else {
+			unique_lock<mutex> guard (lock);
+			turn.wait (guard, [this, &frame] {
+				return nextWrite == frame.number;
+			});
+			if (!error) {
+				guard.unlock();
+				// only the frame whose turn it is writes
+				sequence.write (image.data(), image.size());
+				guard.lock();
+				if (!sequence) {
+					error = std::make_exception_ptr (std::system_error (errno, std::generic_category(), target));
+				}
+			}
+			nextWrite++;
+			turn.notify_all();
+			if (error) {
+				return;
+			}
+		}
+		written++;
+		bytes += image.size();
+	}
+
+	/**
+	 * @brief returns the number of frames submitted
+	 * @return the frames
+	 **/
+	long Exporter::getSubmitted() const {
+		return submitted;
+	}
+
+	/**
+	 * @brief returns the number of frames written
+	 * @return the frames
+	 **/
+	long Exporter::getWritten() const {
+		return written;
+	}
+
+	/**
+	 * @brief returns how many times submit() had to wait for the workers
+	 * @return the stalls
+	 **/
+	long Exporter::getStalls() const {
+		return stalls;
+	}
+
+	/**
+	 * @brief returns the bytes written
+	 * @return the bytes
+	 **/
+	uint64_t Exporter::getBytes() const {
+		return bytes;
+	}
+}
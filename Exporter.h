@@ -0,0 +1,111 @@
+#ifndef _EXPORTER_H_
+#define _EXPORTER_H_
+#include "Board.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// frames submitted but not yet written before submit() waits
+#define DEFAULT_EXPORT_QUEUE 8
+
+namespace Life {
+	using std::string;
+	using std::vector;
+
+	/**
+	 * writes generations as netpbm images (PBM, or PGM grey levels) on background threads
+	 * the simulation thread only copies the cells into a recycled frame and queues it,
+	 * the workers crop, scale, encode and write. at most the queue capacity of frames is
+	 * outstanding, submit() waits for a free one (counted as a stall).
+	 * living cells are black. images are either one file per frame (target + 6 digit frame
+	 * number + ".pbm"/".pgm") or all in one file (target), which is a valid netpbm stream
+	 * of raw images (e.g. for ffmpeg -f image2pipe).
+	 **/
+	class Exporter {
+	public:
+		enum Format { PBM, PGM };
+
+		enum Layout {
+			FILES, // a file per frame
+			SEQUENCE // every frame in one file, in order
+		};
+	private:
+		// how a frame is rendered (fixed when it is submitted)
+		struct View {
+			// pixels per cell
+			int scale;
+			// cells per pixel (PGM averages them, PBM sets a pixel if any lives)
+			int shrink;
+			// the cropped area in board coordinates (height 0 - the whole board)
+			int row, column, height, width;
+		};
+
+		struct Frame {
+			Matrix<bool> cells;
+			int top, left;
+			long number;
+			View view;
+		};
+
+		string target;
+		Format format;
+		Layout layout;
+		View view;
+		size_t capacity;
+		std::ofstream sequence;
+
+		std::mutex lock;
+		std::condition_variable queued, freed, turn;
+		std::deque<Frame *> pending;
+		vector<Frame *> spare;
+		// frames submitted and not yet written
+		size_t outstanding;
+		// the next frame to go to the sequence file
+		long nextWrite;
+		bool closing;
+		std::exception_ptr error;
+		std::atomic<long> submitted, written, stalls;
+		std::atomic<uint64_t> bytes;
+		vector<std::thread> workers;
+
+		void work();
+
+		void encode (const Frame &, vector<char> &) const;
+
+		void write (const Frame &, const vector<char> &);
+	public:
+		Exporter (const string &, const Format = PBM, const Layout = FILES, const int = 0,
+		          const size_t = DEFAULT_EXPORT_QUEUE);
+
+		~Exporter();
+
+		Exporter &setScale (const int);
+
+		Exporter &setShrink (const int);
+
+		Exporter &setCrop (const int, const int, const int, const int);
+
+		Exporter &submit (const Board &);
+
+		Exporter &run (Board &, const long);
+
+		void finish();
+
+		long getSubmitted() const;
+
+		long getWritten() const;
+
+		long getStalls() const;
+
+		uint64_t getBytes() const;
+	};
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef _FRAME_RING_H_
+#define _FRAME_RING_H_
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace Life {
+	/**
+	 * bounded single-producer/single-consumer lock-free ring
+	 * exactly one thread may push and exactly one (other) thread may pop.
+	 * the capacity is rounded up to a power of two.
+	 **/
+	template<class T> class FrameRing {
+		enum { CACHE_LINE = 64 };
+
+		std::vector<T> slots;
+		size_t mask;
+		// the indices live on separate cache lines so the two threads don't false-share
+		char padding0[CACHE_LINE];
+		// next slot to pop (written by the consumer)
+		std::atomic<size_t> head;
+		char padding1[CACHE_LINE - sizeof (std::atomic<size_t>)];
+		// next slot to push (written by the producer)
+		std::atomic<size_t> tail;
+		char padding2[CACHE_LINE - sizeof (std::atomic<size_t>)];
+
+		static size_t roundUp (const size_t capacity) {
+			size_t ret = 1;
+			while (ret < capacity) {
+				ret <<= 1;
+			}
+			return ret;
+		}
+	public:
+		/**
+		 * creates an empty ring
+		 * @param capacity the minimal number of slots
+		 **/
+		explicit FrameRing (const size_t capacity) : slots (roundUp (capacity)), mask (slots.size() - 1), head (0), tail (0) {
+		}
+
+		FrameRing (const FrameRing &) = delete;
+		FrameRing &operator= (const FrameRing &) = delete;
+
+		/**
+		 * appends a value (producer only)
+		 * @param value the value
+		 * @return false if the ring is full
+		 **/
+		bool push (const T &value) {
+			const size_t t = tail.load (std::memory_order_relaxed);
+			if (t - head.load (std::memory_order_acquire) == slots.size()) {
+				return false;
+			}
+			slots[t & mask] = value;
+			tail.store (t + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * removes the oldest value (consumer only)
+		 * @param value receives the value
+		 * @return false if the ring is empty
+		 **/
+		bool pop (T &value) {
+			const size_t h = head.load (std::memory_order_relaxed);
+			if (h == tail.load (std::memory_order_acquire)) {
+				return false;
+			}
+			value = slots[h & mask];
+			head.store (h + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * returns the number of queued values (a snapshot when called concurrently)
+		 * @return the number of values
+		 **/
+		size_t size() const {
+			return tail.load (std::memory_order_acquire) - head.load (std::memory_order_acquire);
+		}
+
+		size_t capacity() const {
+			return slots.size();
+		}
+	};
+}
+
+#endif
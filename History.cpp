@@ -0,0 +1,206 @@
+#include "History.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace Life {
+	using ::Matrix::OutOfBounds;
+	using std::vector;
+
+	/**
+	 * @brief starts a segment
+	 * @param start the generation of the keyframe
+	 * @param keyframe the keyframe
+	 **/
+	History::Segment::Segment (const long start, const Board &keyframe) : start (start), keyframe (keyframe) {
+	}
+
+	/**
+	 * @brief returns the number of generations in the segment
+	 * @return the keyframe and its deltas
+	 **/
+	long History::Segment::generations() const {
+		return 1 + offsets.size();
+	}
+
+	/**
+	 * @brief returns the memory held by the segment
+	 * @return bytes used
+	 **/
+	size_t History::Segment::bytes() const {
+		return keyframeBytes (keyframe) + data.capacity() * sizeof (word) + offsets.capacity() * sizeof (size_t);
+	}
+
+	/**
+	 * @brief builds an empty history
+	 * @param keyframeInterval generations per keyframe (1 keeps full copies only)
+	 * @param memoryBudget bytes to keep at most (the latest keyframe is always kept)
+	 **/
+	History::History (const int keyframeInterval, const size_t memoryBudget) : nextGeneration (0),
+		keyframeInterval (std::max (keyframeInterval, 1)), memoryBudget (memoryBudget), memoryUsed (0),
+		latestTop (0), latestLeft (0) {
+	}
+
+	/**
+	 * @brief appends a generation
+	 * a new keyframe is started every keyframeInterval generations,
+	 * and whenever the board size (or origin) changes
+	 * @param b the board
+	 * @return the generation number it was recorded as
+	 **/
+	long History::record (const Board &b) {
+		const Matrix<bool> &cells = b.getCells();
+		bool resized = latest.getHeight() != cells.getHeight() || latest.getWidth() != cells.getWidth()
+		               || latestTop != b.top || latestLeft != b.left;
+		if (segments.empty() || resized || segments.back().generations() >= keyframeInterval) {
+			if (!segments.empty()) {
+				// the previous segment is complete, drop its spare capacity
+				Segment &previous = segments.back();
+				size_t before = previous.bytes();
+				previous.data.shrink_to_fit();
+				previous.offsets.shrink_to_fit();
+				memoryUsed -= before - previous.bytes();
+			}
+			segments.emplace_back (nextGeneration, b);
+			memoryUsed += segments.back().bytes();
+		} else {
+			Segment &segment = segments.back();
+			size_t before = segment.bytes();
+			segment.offsets.push_back (segment.data.size());
+			encode (latest, cells, segment.data);
+			memoryUsed += segment.bytes() - before;
+		}
+		latest = cells;
+		latestTop = b.top;
+		latestLeft = b.left;
+		while (memoryUsed > memoryBudget && segments.size() > 1) {
+			memoryUsed -= segments.front().bytes();
+			segments.pop_front();
+		}
+		return nextGeneration++;
+	}
+
+	/**
+	 * @brief rebuilds a recorded generation from its keyframe
+	 * throws OutOfBounds if the generation isn't in the history
+	 * @param generation the generation
+	 * @return the board at that generation
+	 **/
+	Board History::at (const long generation) const {
+		if (generation < getFirst() || generation > getLast()) {
+			throw OutOfBounds();
+		}
+		// the last segment starting at or before the generation
+		auto segment = std::upper_bound (segments.begin(), segments.end(), generation,
+		[] (const long g, const Segment & s) {
+			return g < s.start;
+		}) - 1;
+		Board ret = segment->keyframe;
+		long count = generation - segment->start;
+		for (long i = 0; i < count; i++) {
+			const word *begin = segment->data.data() + segment->offsets[i];
+			const word *end = segment->data.data() + (i + 1 < (long) segment->offsets.size() ?
+			                  segment->offsets[i + 1] : segment->data.size());
+			decode (begin, end, ret.board);
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief returns the oldest generation still kept
+	 * @return the oldest generation (getLast() + 1 if empty)
+	 **/
+	long History::getFirst() const {
+		return segments.empty() ? nextGeneration : segments.front().start;
+	}
+
+	/**
+	 * @brief returns the latest recorded generation
+	 * @return the latest generation (-1 if nothing was recorded)
+	 **/
+	long History::getLast() const {
+		return nextGeneration - 1;
+	}
+
+	/**
+	 * @brief returns the memory held by keyframes and deltas
+	 * @return bytes used
+	 **/
+	size_t History::getMemoryUsage() const {
+		return memoryUsed;
+	}
+
+	/**
+	 * @brief forgets all the recorded generations (numbering continues)
+	 * @return *this
+	 **/
+	History &History::clear() {
+		segments.clear();
+		latest = Matrix<bool>();
+		memoryUsed = 0;
+		return *this;
+	}
+
+	/**
+	 * @brief appends the XOR delta from -> to, run-length encoded:
+	 * a header word (equal words to skip << 32 | differing words that follow),
+	 * then the XOR of each differing word. trailing equal words are implicit.
+	 * @param from the previous cells
+	 * @param to the current cells (same size)
+	 * @param out the encoded delta is appended here
+	 **/
+	void History::encode (const Matrix<bool> &from, const Matrix<bool> &to, vector<word> &out) {
+		const int stride = to.getStride();
+		// equal words since the last differing one, and the header of the current run of differing ones
+		size_t equal = 0;
+		size_t header = 0;
+		bool open = false;
+		for (int r = 0; r < to.getHeight(); r++) {
+			const word *a = from.rowWords (r);
+			const word *b = to.rowWords (r);
+			for (int w = 0; w < stride; w++) {
+				if (a[w] == b[w]) {
+					equal++;
+					open = false;
+					continue;
+				}
+				if (!open) {
+					open = true;
+					header = out.size();
+					out.push_back (word (equal) << 32);
+					equal = 0;
+				}
+				out[header]++;
+				out.push_back (a[w] ^ b[w]);
+			}
+		}
+	}
+
+	/**
+	 * @brief applies an encoded delta in place
+	 * @param begin the first word of the delta
+	 * @param end past the last word of the delta
+	 * @param cells the cells to update
+	 **/
+	void History::decode (const word *begin, const word *end, Matrix<bool> &cells) {
+		const size_t stride = cells.getStride();
+		size_t position = 0;
+		while (begin != end) {
+			position += *begin >> 32;
+			size_t count = *begin & 0xFFFFFFFF;
+			begin++;
+			for (size_t k = 0; k < count; k++, position++) {
+				cells.rowWords (position / stride) [position % stride] ^= *begin++;
+			}
+		}
+	}
+
+	/**
+	 * @brief returns the memory held by a keyframe
+	 * @param b the keyframe
+	 * @return bytes used
+	 **/
+	size_t History::keyframeBytes (const Board &b) {
+		return sizeof (Board) + size_t (b.board.getHeight()) * b.board.getStride() * sizeof (word);
+	}
+}
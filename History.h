@@ -0,0 +1,74 @@
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+#include "Board.h"
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// default history parameters
+#define DEFAULT_KEYFRAME_INTERVAL 64
+#define DEFAULT_HISTORY_BUDGET (64 << 20)
+
+namespace Life {
+	/**
+	 * generation history of a board
+	 * every keyframeInterval generations a full copy (keyframe) is kept,
+	 * the generations in between are stored as run-length encoded XOR deltas
+	 * from their predecessor. any recorded generation is rebuilt from the
+	 * nearest earlier keyframe. when the memory budget is exceeded the oldest
+	 * keyframe and its deltas are dropped.
+	 **/
+	class History {
+		typedef Matrix<bool>::word word;
+
+		/**
+		 * a keyframe followed by the deltas of the next generations
+		 **/
+		struct Segment {
+			long start;
+			Board keyframe;
+			// concatenated deltas, delta i starts at offsets[i]
+			std::vector<word> data;
+			std::vector<size_t> offsets;
+
+			Segment (const long, const Board &);
+
+			long generations() const;
+
+			size_t bytes() const;
+		};
+
+		std::deque<Segment> segments;
+		// the cells of the last recorded generation
+		Matrix<bool> latest;
+		long nextGeneration;
+		int keyframeInterval;
+		size_t memoryBudget;
+		size_t memoryUsed;
+		// the position of the last recorded generation
+		int latestTop, latestLeft;
+
+		static size_t keyframeBytes (const Board &);
+	public:
+		// the delta codec (also used for network frames)
+		static void encode (const Matrix<bool> &, const Matrix<bool> &, std::vector<word> &);
+
+		static void decode (const word *, const word *, Matrix<bool> &);
+
+		History (const int = DEFAULT_KEYFRAME_INTERVAL, const size_t = DEFAULT_HISTORY_BUDGET);
+
+		long record (const Board &);
+
+		Board at (const long) const;
+
+		long getFirst() const;
+
+		long getLast() const;
+
+		size_t getMemoryUsage() const;
+
+		History &clear();
+	};
+}
+
+#endif
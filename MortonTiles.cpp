@@ -0,0 +1,158 @@
+#include "MortonTiles.h"
+#include <algorithm>
+#include <numeric>
+
+namespace Life {
+	/**
+	 * @brief builds an empty (0*0) set of tiles
+	 **/
+	MortonTiles::MortonTiles() : height (0), width (0), tileRows (0), tileColumns (0) {
+	}
+
+	/**
+	 * @brief spreads the bits of a number to the even bits of the result
+	 * @param x the number
+	 * @return the spread bits
+	 **/
+	uint64_t MortonTiles::spread (const uint32_t x) {
+		uint64_t v = x;
+		v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+		v = (v | (v << 8)) & 0x00FF00FF00FF00FFULL;
+		v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		v = (v | (v << 2)) & 0x3333333333333333ULL;
+		v = (v | (v << 1)) & 0x5555555555555555ULL;
+		return v;
+	}
+
+	/**
+	 * @brief sets the size of the board (all the cells are dead afterwards)
+	 * the Morton order is only rebuilt if the number of tiles changes
+	 * @param h the height
+	 * @param w the width
+	 **/
+	void MortonTiles::resize (const int h, const int w) {
+		const int rows = (h + SIDE - 1) / SIDE, columns = (w + SIDE - 1) / SIDE;
+		height = h;
+		width = w;
+		if (rows != tileRows || columns != tileColumns) {
+			tileRows = rows;
+			tileColumns = columns;
+			const size_t count = size_t (rows) * columns;
+			vector<uint64_t> codes (count);
+			vector<int> order (count);
+			for (int r = 0; r < rows; r++) {
+				for (int c = 0; c < columns; c++) {
+					codes[size_t (r) * columns + c] = spread (r) << 1 | spread (c);
+				}
+			}
+			std::iota (order.begin(), order.end(), 0);
+			std::sort (order.begin(), order.end(), [&codes] (const int a, const int b) {
+				return codes[a] < codes[b];
+			});
+			slots.assign (count, 0);
+			for (size_t k = 0; k < count; k++) {
+				slots[order[k]] = k;
+			}
+		}
+		words.assign (size_t (tileRows) * tileColumns * SIDE, 0);
+	}
+
+	/**
+	 * @brief frees the tiles
+	 **/
+	void MortonTiles::clear() {
+		vector<int>().swap (slots);
+		vector<word>().swap (words);
+		height = width = tileRows = tileColumns = 0;
+	}
+
+	/**
+	 * @brief copies the cells of a bit matrix into the tiles (resized to it)
+	 * @param cells the cells
+	 **/
+	void MortonTiles::pack (const Cells &cells) {
+		resize (cells.getHeight(), cells.getWidth());
+		for (int i = 0; i < height; i++) {
+			const word *row = cells.rowWords (i);
+			for (int c = 0; c < tileColumns; c++) {
+				tile (i / SIDE, c) [i % SIDE] = row[c];
+			}
+		}
+	}
+
+	/**
+	 * @brief copies the tiles into a bit matrix of the same size
+	 * (bands it shares with copies are dropped, not copied - every word is overwritten)
+	 * @param cells the cells
+	 **/
+	void MortonTiles::unpack (Cells &cells) const {
+		cells.unshare (false);
+		for (int i = 0; i < height; i++) {
+			word *row = cells.rowWords (i);
+			for (int c = 0; c < tileColumns; c++) {
+				row[c] = tile (i / SIDE, c) [i % SIDE];
+			}
+		}
+	}
+
+	/**
+	 * @brief reads a cell (no bounds checking)
+	 * @param r row
+	 * @param c column
+	 * @return the cell
+	 **/
+	bool MortonTiles::operator() (const int r, const int c) const {
+		return (tile (r / SIDE, c / SIDE) [r % SIDE] >> (c % SIDE)) & 1;
+	}
+
+	/**
+	 * @brief returns the number of live cells
+	 * @return the population
+	 **/
+	long MortonTiles::count() const {
+		long ret = 0;
+		for (word w : words) {
+			ret += __builtin_popcountll (w);
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief checks if the tiles hold a board of the given size
+	 * @param h the height
+	 * @param w the width
+	 * @return true if they do
+	 **/
+	bool MortonTiles::fits (const int h, const int w) const {
+		return h == height && w == width;
+	}
+
+	int MortonTiles::getHeight() const {
+		return height;
+	}
+
+	int MortonTiles::getWidth() const {
+		return width;
+	}
+
+	int MortonTiles::getTileRows() const {
+		return tileRows;
+	}
+
+	int MortonTiles::getTileColumns() const {
+		return tileColumns;
+	}
+
+	/**
+	 * @brief exchanges the cells of two sets of tiles
+	 * @param other the other tiles
+	 **/
+	void MortonTiles::swap (MortonTiles &other) {
+		std::swap (height, other.height);
+		std::swap (width, other.width);
+		std::swap (tileRows, other.tileRows);
+		std::swap (tileColumns, other.tileColumns);
+		slots.swap (other.slots);
+		words.swap (other.words);
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef _MORTON_TILES_H_
+#define _MORTON_TILES_H_
+#include "matrix.h"
+#include <cstdint>
+#include <vector>
+
+namespace Life {
+	using std::vector;
+
+	/**
+	 * the cells of a board in SIDE*SIDE tiles, a word per tile row, tiles stored in Morton (Z) order:
+	 * the rows above and below a cell are in the words next to its own, and tiles that are near
+	 * on the board are mostly near in memory - unlike row-major storage, where they are a full row apart.
+	 * the order is the rank of each tile's Morton code, so boards of any shape are stored densely.
+	 * the cells beyond the height and width of the board are kept dead.
+	 **/
+	class MortonTiles {
+	public:
+		typedef ::Matrix::Matrix<bool> Cells;
+
+		typedef Cells::word word;
+
+		enum { SIDE = Cells::wordBits };
+	private:
+		int height, width, tileRows, tileColumns;
+		// the position of tile (r, c) in the Morton order, at r * tileColumns + c
+		vector<int> slots;
+		vector<word> words;
+
+		static uint64_t spread (const uint32_t);
+	public:
+		MortonTiles();
+
+		void resize (const int, const int);
+
+		void clear();
+
+		void pack (const Cells &);
+
+		void unpack (Cells &) const;
+
+		bool operator() (const int, const int) const;
+
+		long count() const;
+
+		/**
+		 * @brief returns the words of a tile, one per row
+		 * @param r the tile row
+		 * @param c the tile column
+		 * @return the SIDE words of the tile, nullptr outside of the board
+		 **/
+		const word *tile (const int r, const int c) const {
+			if (r < 0 || c < 0 || r >= tileRows || c >= tileColumns) {
+				return nullptr;
+			}
+			return words.data() + size_t (slots[r * tileColumns + c]) * SIDE;
+		}
+
+		word *tile (const int r, const int c) {
+			return const_cast<word *> (static_cast<const MortonTiles &> (*this).tile (r, c));
+		}
+
+		bool fits (const int, const int) const;
+
+		int getHeight() const;
+
+		int getWidth() const;
+
+		int getTileRows() const;
+
+		int getTileColumns() const;
+
+		void swap (MortonTiles &);
+	};
+}
+
+#endif
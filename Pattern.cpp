@@ -0,0 +1,203 @@
+#include "Pattern.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+namespace Life {
+	using std::max;
+	using std::min;
+
+	/**
+	 * @brief builds an empty (0*0) pattern
+	 **/
+	Pattern::Pattern() : height (0), width (0) {
+	}
+
+	/**
+	 * @brief reads a pattern, telling the format from its first line
+	 * @param in the stream
+	 * @return the pattern
+	 **/
+	Pattern Pattern::read (istream &in) {
+		Pattern ret;
+		string line;
+		while (std::getline (in, line)) {
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			if (line.compare (0, 10, "#Life 1.06") == 0) {
+				ret.readLife106 (in);
+				return ret;
+			}
+			if (line.empty() || line[0] == '#' || line[0] == '!') {
+				continue;
+			}
+			const size_t start = line.find_first_not_of (" \t");
+			if (start != string::npos && line[start] == 'x' && line.find ('=') != string::npos) {
+				ret.readRle (in, line);
+			} else {
+				ret.readPlaintext (in, line);
+			}
+			return ret;
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief reads a pattern file
+	 * @param file the file name
+	 * @return the pattern
+	 **/
+	Pattern Pattern::load (const string &file) {
+		std::ifstream in (file);
+		if (!in) {
+			throw std::system_error (errno, std::generic_category(), file);
+		}
+		return read (in);
+	}
+
+	/**
+	 * @brief adds a live cell, extending the size
+	 * @param r row
+	 * @param c column
+	 **/
+	void Pattern::add (const int r, const int c) {
+		cells.push_back (std::make_pair (r, c));
+		height = max (height, r + 1);
+		width = max (width, c + 1);
+	}
+
+	/**
+	 * @brief reads the runs of an RLE pattern
+	 * @param in the stream, after the header
+	 * @param header the header line
+	 **/
+	void Pattern::readRle (istream &in, const string &header) {
+		std::istringstream fields (header);
+		string field;
+		while (std::getline (fields, field, ',')) {
+			const size_t equals = field.find ('=');
+			if (equals == string::npos) {
+				continue;
+			}
+			string key = field.substr (0, equals), value = field.substr (equals + 1);
+			key.erase (std::remove_if (key.begin(), key.end(), ::isspace), key.end());
+			value.erase (std::remove_if (value.begin(), value.end(), ::isspace), value.end());
+			if (key == "x") {
+				width = max (0, atoi (value.c_str()));
+			} else if (key == "y") {
+				height = max (0, atoi (value.c_str()));
+			} else if (key == "rule") {
+				rule = value;
+			}
+		}
+		int r = 0, c = 0;
+		long count = 0;
+		char ch;
+		while (in.get (ch) && ch != '!') {
+			if (isdigit ((unsigned char) ch)) {
+				count = min<long> (count * 10 + (ch - '0'), INT_MAX);
+				continue;
+			}
+			if (ch == '#') {
+				string comment;
+				std::getline (in, comment);
+				continue;
+			}
+			if (isspace ((unsigned char) ch)) {
+				continue;
+			}
+			const int run = count > 0 ? count : 1;
+			count = 0;
+			if (ch == '$') {
+				r += run;
+				c = 0;
+			} else if (ch == 'b' || ch == '.') {
+				c += run;
+			} else if (isalpha ((unsigned char) ch)) {
+				// o, or any state of a multi-state rule
+				for (int i = 0; i < run; i++) {
+					add (r, c++);
+				}
+			} else {
+				throw std::runtime_error (string ("unexpected '") + ch + "' in RLE pattern");
+			}
+		}
+	}
+
+	/**
+	 * @brief reads the coordinates of a Life 1.06 pattern (moved to non-negative rows and columns)
+	 * @param in the stream, after the #Life line
+	 **/
+	void Pattern::readLife106 (istream &in) {
+		vector<pair<int, int>> read;
+		int top = INT_MAX, left = INT_MAX;
+		string line;
+		while (std::getline (in, line)) {
+			if (line.empty() || line[0] == '#' || line.find_first_not_of (" \t\r") == string::npos) {
+				continue;
+			}
+			std::istringstream coordinates (line);
+			int x, y;
+			if (! (coordinates >> x >> y)) {
+				throw std::runtime_error ("bad coordinates in Life 1.06 pattern: " + line);
+			}
+			read.push_back (std::make_pair (y, x));
+			top = min (top, y);
+			left = min (left, x);
+		}
+		for (auto &cell : read) {
+			add (cell.first - top, cell.second - left);
+		}
+	}
+
+	/**
+	 * @brief reads the rows of a plaintext pattern
+	 * @param in the stream, after the first row
+	 * @param first the first row
+	 **/
+	void Pattern::readPlaintext (istream &in, const string &first) {
+		string line = first;
+		int r = 0;
+		do {
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			if (!line.empty() && line[0] == '!') {
+				continue;
+			}
+			for (size_t c = 0; c < line.size(); c++) {
+				if (line[c] == 'O' || line[c] == 'o' || line[c] == '*') {
+					add (r, c);
+				} else if (line[c] != '.' && line[c] != ' ' && line[c] != '\t') {
+					throw std::runtime_error (string ("unexpected '") + line[c] + "' in plaintext pattern");
+				}
+			}
+			height = max (height, r + 1);
+			width = max<int> (width, line.size());
+			r++;
+		} while (std::getline (in, line));
+	}
+
+	int Pattern::getHeight() const {
+		return height;
+	}
+
+	int Pattern::getWidth() const {
+		return width;
+	}
+
+	const vector<pair<int, int>> &Pattern::getCells() const {
+		return cells;
+	}
+
+	const string &Pattern::getRule() const {
+		return rule;
+	}
+}
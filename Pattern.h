@@ -0,0 +1,51 @@
+#ifndef _PATTERN_H_
+#define _PATTERN_H_
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Life {
+	using std::istream;
+	using std::pair;
+	using std::string;
+	using std::vector;
+
+	/**
+	 * the live cells of a pattern file, relative to its top left corner
+	 * reads RLE (x = .., y = .., rule = .. header, b/o runs, $ and !), Life 1.06 (#Life 1.06, then a
+	 * "x y" pair per live cell) and plaintext (.cells: '!' comments, '.' dead and 'O' or '*' alive) -
+	 * so the output of a Board (' ' dead, '*' alive) can be read back as well.
+	 * malformed input throws std::runtime_error, an unreadable file std::system_error.
+	 **/
+	class Pattern {
+		int height, width;
+		vector<pair<int, int>> cells;
+		// the rule of the RLE header, empty if none
+		string rule;
+
+		void add (const int, const int);
+
+		void readRle (istream &, const string &);
+
+		void readLife106 (istream &);
+
+		void readPlaintext (istream &, const string &);
+	public:
+		Pattern();
+
+		static Pattern read (istream &);
+
+		static Pattern load (const string &);
+
+		int getHeight() const;
+
+		int getWidth() const;
+
+		const vector<pair<int, int>> &getCells() const;
+
+		const string &getRule() const;
+	};
+}
+
+#endif
@@ -0,0 +1,169 @@
+#include "Pipeline.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+namespace Life {
+	using std::endl;
+	using std::ostream;
+	using std::thread;
+
+	/**
+	 * @brief builds a pipeline
+	 * @param out the output stream (written by the output thread only)
+	 * @param capacity frames that may be queued
+	 * @param policy what to do when the output falls behind
+	 **/
+	Pipeline::Pipeline (ostream &out, const size_t capacity, const Policy policy) : out (out), policy (policy),
+		cadence (1), frames (capacity), recycled (capacity + 2), mailbox (nullptr), finished (false), produced (0), written (0),
+		dropped (0) {
+	}
+
+	Pipeline::~Pipeline() {
+		Board *frame;
+		while (frames.pop (frame)) {
+			delete frame;
+		}
+		while (recycled.pop (frame)) {
+			delete frame;
+		}
+		delete mailbox.exchange (nullptr);
+	}
+
+	/**
+	 * @brief prints only every given generation (the last one is always printed)
+	 * @param every generations between frames (1 - every generation)
+	 * @return *this
+	 **/
+	Pipeline &Pipeline::setCadence (const long every) {
+		cadence = std::max (1L, every);
+		return *this;
+	}
+
+	/**
+	 * @brief prints the board and the given number of generations after it,
+	 * simulating on the calling thread while a second thread prints
+	 * (each frame is followed by an empty line, as `out << board << endl`)
+	 * @param b the board to advance
+	 * @param generations the number of steps
+	 * @return *this
+	 **/
+	Pipeline &Pipeline::run (Board &b, const long generations) {
+		finished = false;
+		thread printer (&Pipeline::output, this);
+		publish (snapshot (b), generations == 0);
+		for (long i = 0; i < generations;) {
+			const long steps = std::min (cadence, generations - i);
+			b.step (steps);
+			i += steps;
+			publish (snapshot (b), i == generations);
+		}
+		finished = true;
+		printer.join();
+		return *this;
+	}
+
+	/**
+	 * @brief copies the board into a recycled frame (or a new one)
+	 * @param b the board
+	 * @return the snapshot
+	 **/
+	Board *Pipeline::snapshot (const Board &b) {
+		Board *frame;
+		if (recycled.pop (frame)) {
+			*frame = b;
+		} else {
+			frame = new Board (b);
+		}
+		produced++;
+		return frame;
+	}
+
+	/**
+	 * @brief hands a snapshot to the output thread according to the policy
+	 * @param frame the snapshot (owned by the pipeline from now on)
+	 * @param last true for the final generation, which is never dropped
+	 **/
+	void Pipeline::publish (Board *frame, const bool last) {
+		if (policy == LATEST) {
+			frame = mailbox.exchange (frame);
+			if (frame != nullptr) {
+				// never printed - replaced by a newer one
+				dropped++;
+				delete frame;
+			}
+			return;
+		}
+		if (policy == DROP && !last) {
+			if (!frames.push (frame)) {
+				dropped++;
+				delete frame;
+			}
+			return;
+		}
+		while (!frames.push (frame)) {
+			std::this_thread::yield();
+		}
+	}
+
+	/**
+	 * @brief the output thread - prints frames until the simulation finished and everything was taken
+	 **/
+	void Pipeline::output() {
+		while (true) {
+			// read the flag first, so nothing published before it is missed
+			bool done = finished;
+			Board *frame = nullptr;
+			if (policy == LATEST) {
+				frame = mailbox.exchange (nullptr);
+			} else {
+				frames.pop (frame);
+			}
+			if (frame == nullptr) {
+				if (done) {
+					break;
+				}
+				std::this_thread::yield();
+				continue;
+			}
+			out << *frame << endl;
+			written++;
+			release (frame);
+		}
+		out.flush();
+	}
+
+	/**
+	 * @brief returns a printed frame to the simulation for reuse
+	 * @param frame the frame
+	 **/
+	void Pipeline::release (Board *frame) {
+		if (!recycled.push (frame)) {
+			delete frame;
+		}
+	}
+
+	/**
+	 * @brief returns the number of snapshots taken
+	 * @return frames produced by the simulation
+	 **/
+	long Pipeline::getProduced() const {
+		return produced;
+	}
+
+	/**
+	 * @brief returns the number of frames printed
+	 * @return frames written by the output thread
+	 **/
+	long Pipeline::getWritten() const {
+		return written;
+	}
+
+	/**
+	 * @brief returns the number of frames skipped because the output fell behind
+	 * @return frames dropped
+	 **/
+	long Pipeline::getDropped() const {
+		return dropped;
+	}
+}
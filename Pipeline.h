@@ -0,0 +1,67 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+#include "Board.h"
+#include "FrameRing.h"
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+
+// frames queued between the simulation and the output
+#define DEFAULT_RING_CAPACITY 16
+
+namespace Life {
+	using std::ostream;
+
+	/**
+	 * runs the simulation and the output concurrently
+	 * the simulation (calling) thread pushes immutable snapshots of every generation
+	 * through a lock-free ring to an output thread, which prints them.
+	 * snapshots are recycled back through a second ring, so steady state doesn't allocate.
+	 **/
+	class Pipeline {
+	public:
+		// what the simulation does when the output falls behind
+		enum Policy {
+			BLOCK, // wait for a free slot - every frame is printed
+			DROP, // skip the new frame while the ring is full (the last one is always printed)
+			LATEST // keep only the newest unprinted frame
+		};
+	private:
+		ostream &out;
+		Policy policy;
+		// generations between printed frames
+		long cadence;
+		// simulation -> output
+		FrameRing<Board *> frames;
+		// output -> simulation
+		FrameRing<Board *> recycled;
+		// the single pending frame of the LATEST policy
+		std::atomic<Board *> mailbox;
+		std::atomic<bool> finished;
+		std::atomic<long> produced, written, dropped;
+
+		Board *snapshot (const Board &);
+
+		void publish (Board *, const bool);
+
+		void output();
+
+		void release (Board *);
+	public:
+		Pipeline (ostream &, const size_t = DEFAULT_RING_CAPACITY, const Policy = BLOCK);
+
+		~Pipeline();
+
+		Pipeline &setCadence (const long);
+
+		Pipeline &run (Board &, const long);
+
+		long getProduced() const;
+
+		long getWritten() const;
+
+		long getDropped() const;
+	};
+}
+
+#endif
@@ -0,0 +1,514 @@
+#include "Server.h"
+#include "History.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace Life {
+	using std::lock_guard;
+	using std::mutex;
+	using std::shared_ptr;
+	using std::unique_lock;
+
+	/**
+	 * @brief sets a descriptor to non-blocking mode
+	 * @param fd the descriptor
+	 **/
+	static void nonBlocking (const int fd) {
+		fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+	}
+
+	/**
+	 * @brief reads a value from an unaligned buffer
+	 * @param p the buffer
+	 * @return the value
+	 **/
+	template<class T> static T load (const char *p) {
+		T value;
+		std::memcpy (&value, p, sizeof (T));
+		return value;
+	}
+
+	Server::Session::Session (const int fd) : fd (fd), generation (0), remaining (0), written (0), queued (false),
+		closed (false), ended (false) {
+	}
+
+	/**
+	 * @brief builds a server listening on a Unix domain socket
+	 * @param path the socket path (an existing file there is replaced)
+	 * @param threads workers stepping the sessions (0 - one per hardware thread)
+	 * @param maxPending unwritten frames that pause a session
+	 **/
+	Server::Server (const string &path, const int threads, const size_t maxPending) : Server (threads, maxPending) {
+		sockaddr_un address;
+		std::memset (&address, 0, sizeof (address));
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof (address.sun_path)) {
+			throw std::system_error (ENAMETOOLONG, std::generic_category(), path);
+		}
+		std::strcpy (address.sun_path, path.c_str());
+		listener = socket (AF_UNIX, SOCK_STREAM, 0);
+		unlink (path.c_str());
+		if (listener < 0 || bind (listener, reinterpret_cast<sockaddr *> (&address), sizeof (address)) != 0
+		        || listen (listener, SOMAXCONN) != 0) {
+			int error = errno;
+			stop();
+			throw std::system_error (error, std::generic_category(), path);
+		}
+		this->path = path;
+		nonBlocking (listener);
+	}
+
+	/**
+	 * @brief builds a server without a socket of its own - connections are attach()ed
+	 * (e.g. one end of a socketpair)
+	 * @param threads workers stepping the sessions (0 - one per hardware thread)
+	 * @param maxPending unwritten frames that pause a session
+	 **/
+	Server::Server (const int threads, const size_t maxPending) : listener (-1), maxPending (std::max<size_t> (maxPending,
+		        1)), stopping (false) {
+		if (pipe (wake) != 0) {
+			throw std::system_error (errno, std::generic_category(), "pipe");
+		}
+		nonBlocking (wake[0]);
+		nonBlocking (wake[1]);
+		const int count = threads > 0 ? threads : std::max<int> (1, std::thread::hardware_concurrency());
+		for (int i = 0; i < count; i++) {
+			workers.push_back (std::thread (&Server::work, this));
+		}
+	}
+
+	Server::~Server() {
+		stop();
+		for (auto &t : workers) {
+			if (t.joinable()) {
+				t.join();
+			}
+		}
+		while (!sessions.empty()) {
+			close (sessions.begin()->first);
+		}
+		for (int fd : attached) {
+			::close (fd);
+		}
+		if (listener >= 0) {
+			::close (listener);
+			unlink (path.c_str());
+		}
+		::close (wake[0]);
+		::close (wake[1]);
+	}
+
+	/**
+	 * @brief adds a connected stream socket as a new session (callable from any thread)
+	 * @param fd the socket (owned by the server from now on)
+	 **/
+	void Server::attach (const int fd) {
+		nonBlocking (fd);
+		{
+			lock_guard<mutex> lock (attaching);
+			attached.push_back (fd);
+		}
+		notify();
+	}
+
+	/**
+	 * @brief serves the clients on the calling thread until stop()
+	 **/
+	void Server::run() {
+		vector<pollfd> fds;
+		vector<int> done;
+		while (!stopping) {
+			{
+				lock_guard<mutex> lock (attaching);
+				for (int fd : attached) {
+					sessions[fd] = std::make_shared<Session> (fd);
+				}
+				attached.clear();
+			}
+			fds.clear();
+			fds.push_back (pollfd { wake[0], POLLIN, 0 });
+			if (listener >= 0) {
+				fds.push_back (pollfd { listener, POLLIN, 0 });
+			}
+			done.clear();
+			for (auto &entry : sessions) {
+				lock_guard<mutex> lock (entry.second->lock);
+				if (finished (*entry.second)) {
+					done.push_back (entry.first);
+					continue;
+				}
+				// a half-closed client has nothing more to read (its end would poll readable forever)
+				const short events = entry.second->ended ? 0 : POLLIN;
+				fds.push_back (pollfd { entry.first, short (events | (entry.second->frames.empty() ? 0 : POLLOUT)), 0 });
+			}
+			for (int fd : done) {
+				close (fd);
+			}
+			if (poll (fds.data(), fds.size(), -1) < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				throw std::system_error (errno, std::generic_category(), "poll");
+			}
+			for (const pollfd &p : fds) {
+				if (p.revents == 0) {
+					continue;
+				}
+				if (p.fd == wake[0]) {
+					char drain[64];
+					while (read (wake[0], drain, sizeof (drain)) > 0) {
+					}
+					continue;
+				}
+				if (p.fd == listener) {
+					int fd = accept (listener, nullptr, nullptr);
+					if (fd >= 0) {
+						nonBlocking (fd);
+						sessions[fd] = std::make_shared<Session> (fd);
+					}
+					continue;
+				}
+				auto found = sessions.find (p.fd);
+				if (found == sessions.end()) {
+					continue;
+				}
+				shared_ptr<Session> session = found->second;
+				bool open = true;
+				if (session->ended) {
+					// the client is gone altogether - nobody reads the rest
+					open = (p.revents & (POLLHUP | POLLERR)) == 0;
+				} else if (p.revents & (POLLIN | POLLHUP | POLLERR)) {
+					open = receive (session);
+				}
+				if (open && (p.revents & POLLOUT)) {
+					lock_guard<mutex> lock (session->lock);
+					open = flush (*session);
+					// written frames make room - resume the session if it was held back
+					schedule (session);
+				}
+				if (!open) {
+					close (p.fd);
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief makes run() return, and the workers stop (callable from any thread)
+	 **/
+	void Server::stop() {
+		stopping = true;
+		{
+			lock_guard<mutex> lock (queueLock);
+			queueReady.notify_all();
+		}
+		notify();
+	}
+
+	/**
+	 * @brief a worker - steps the ready sessions a generation at a time, round robin
+	 **/
+	void Server::work() {
+		while (true) {
+			shared_ptr<Session> session;
+			{
+				unique_lock<mutex> lock (queueLock);
+				queueReady.wait (lock, [this] {
+					return stopping || !ready.empty();
+				});
+				if (stopping) {
+					return;
+				}
+				session = ready.front();
+				ready.pop_front();
+			}
+			bool again;
+			{
+				lock_guard<mutex> lock (session->lock);
+				if (runnable (*session)) {
+					session->board->step();
+					session->generation++;
+					if (session->remaining > 0) {
+						session->remaining--;
+					}
+					frame (*session);
+				}
+				again = runnable (*session);
+				session->queued = again;
+			}
+			if (again) {
+				// to the back of the queue - every ready session gets a generation in turn
+				lock_guard<mutex> lock (queueLock);
+				ready.push_back (session);
+				queueReady.notify_one();
+			}
+			notify();
+		}
+	}
+
+	/**
+	 * @brief queues a session for the workers if it has generations to run and room for frames
+	 * (the session must be locked)
+	 * @param session the session
+	 **/
+	void Server::schedule (const shared_ptr<Session> &session) {
+		if (session->queued || !runnable (*session)) {
+			return;
+		}
+		session->queued = true;
+		lock_guard<mutex> lock (queueLock);
+		ready.push_back (session);
+		queueReady.notify_one();
+	}
+
+	/**
+	 * @brief checks if a session should be stepped (the session must be locked)
+	 * @param session the session
+	 * @return true if it has a board, generations to run and room for another frame
+	 **/
+	bool Server::runnable (const Session &session) const {
+		return !session.closed && session.board && session.remaining != 0 && session.frames.size() < maxPending;
+	}
+
+	/**
+	 * @brief checks if a half-closed session has nothing left to do (the session must be locked)
+	 * @param session the session
+	 * @return true if its client's input ended, no generations are left to run (or being run)
+	 * and every frame is written
+	 **/
+	bool Server::finished (const Session &session) const {
+		return session.ended && session.remaining == 0 && !session.queued && session.frames.empty();
+	}
+
+	/**
+	 * @brief encodes the current generation of a session as a frame, a delta if that is smaller
+	 * (the session must be locked)
+	 * @param session the session
+	 **/
+	void Server::frame (Session &session) {
+		const Matrix<bool> &cells = session.board->getCells();
+		const size_t full = size_t (cells.getHeight()) * cells.getStride();
+		vector<word> delta;
+		FrameKind kind = FULL;
+		if (session.sent.getHeight() == cells.getHeight() && session.sent.getWidth() == cells.getWidth()) {
+			History::encode (session.sent, cells, delta);
+			if (delta.size() < full) {
+				kind = DELTA;
+			}
+		}
+		FrameHeader header;
+		header.magic = MAGIC;
+		header.kind = kind;
+		header.generation = session.generation;
+		header.height = cells.getHeight();
+		header.width = cells.getWidth();
+		header.top = session.board->getTop();
+		header.left = session.board->getLeft();
+		header.words = kind == DELTA ? delta.size() : full;
+		vector<char> bytes (sizeof (header) + header.words * sizeof (word));
+		std::memcpy (bytes.data(), &header, sizeof (header));
+		if (kind == DELTA) {
+			std::memcpy (bytes.data() + sizeof (header), delta.data(), header.words * sizeof (word));
+		} else {
+			const size_t rowBytes = cells.getStride() * sizeof (word);
+			for (int r = 0; r < cells.getHeight(); r++) {
+				std::memcpy (bytes.data() + sizeof (header) + r * rowBytes, cells.rowWords (r), rowBytes);
+			}
+		}
+		session.frames.push_back (std::move (bytes));
+		session.sent = cells;
+	}
+
+	/**
+	 * @brief reads what a client sent and handles the complete requests
+	 * @param session the session
+	 * @return false if the connection should be closed
+	 **/
+	bool Server::receive (const shared_ptr<Session> &session) {
+		vector<char> &input = session->input;
+		char buffer[64 << 10];
+		// the client closed its end - what it sent before is still handled
+		bool ended = false;
+		while (true) {
+			ssize_t n = read (session->fd, buffer, sizeof (buffer));
+			if (n > 0) {
+				input.insert (input.end(), buffer, buffer + n);
+				continue;
+			}
+			if (n == 0) {
+				ended = true;
+				break;
+			}
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+			return false;
+		}
+		size_t offset = 0;
+		while (input.size() - offset >= 2 * sizeof (uint32_t)) {
+			const uint32_t type = load<uint32_t> (input.data() + offset);
+			const uint32_t bytes = load<uint32_t> (input.data() + offset + sizeof (uint32_t));
+			if (bytes > MAX_REQUEST_BYTES) {
+				return false;
+			}
+			if (input.size() - offset - 2 * sizeof (uint32_t) < bytes) {
+				break;
+			}
+			if (!handle (session, type, input.data() + offset + 2 * sizeof (uint32_t), bytes)) {
+				return false;
+			}
+			offset += 2 * sizeof (uint32_t) + bytes;
+		}
+		input.erase (input.begin(), input.begin() + offset);
+		// a half-closed client may still read: it is owed the frames of what it asked for,
+		// run() closes the session once they are written (see finished)
+		session->ended = ended;
+		return true;
+	}
+
+	/**
+	 * @brief handles a single request - a request that fails (too large to allocate, or rejected
+	 * by the board) closes only its own connection, like a malformed one
+	 * @param session the session
+	 * @param type the request type
+	 * @param payload the payload
+	 * @param bytes the payload size
+	 * @return false if the request is malformed or failed
+	 **/
+	bool Server::handle (const shared_ptr<Session> &session, const uint32_t type, const char *payload,
+	                     const size_t bytes) {
+		lock_guard<mutex> lock (session->lock);
+		try {
+			return request (session, type, payload, bytes);
+		} catch (const std::bad_alloc &) {
+		} catch (const ::Matrix::InvalidSize &) {
+		} catch (const ::Matrix::OutOfBounds &) {
+		} catch (const ::Matrix::SizeMismatch &) {
+		}
+		return false;
+	}
+
+	/**
+	 * @brief carries out a single request (the session must be locked)
+	 * @param session the session
+	 * @param type the request type
+	 * @param payload the payload
+	 * @param bytes the payload size
+	 * @return false if the request is malformed
+	 **/
+	bool Server::request (const shared_ptr<Session> &session, const uint32_t type, const char *payload,
+	                      const size_t bytes) {
+		switch (type) {
+		case CREATE: {
+			if (bytes != 4 * sizeof (int32_t)) {
+				return false;
+			}
+			const int32_t height = load<int32_t> (payload), width = load<int32_t> (payload + 4);
+			if (height <= 0 || width <= 0 || (long long) height * width > MAX_BOARD_CELLS) {
+				return false;
+			}
+			session->board.reset (new Board (height, width, load<uint32_t> (payload + 8), load<uint32_t> (payload + 12)));
+			session->generation = 0;
+			session->remaining = 0;
+			session->sent = Matrix<bool>();
+			frame (*session);
+			return true;
+		}
+		case CELLS: {
+			if (!session->board || bytes < sizeof (uint32_t) || (bytes - sizeof (uint32_t)) % (2 * sizeof (int32_t)) != 0) {
+				return false;
+			}
+			const uint32_t operation = load<uint32_t> (payload);
+			if (operation > Board::COPY) {
+				return false;
+			}
+			vector<pair<int, int>> cells ( (bytes - sizeof (uint32_t)) / (2 * sizeof (int32_t)));
+			for (size_t i = 0; i < cells.size(); i++) {
+				const char *p = payload + sizeof (uint32_t) + i * 2 * sizeof (int32_t);
+				cells[i] = std::make_pair (load<int32_t> (p), load<int32_t> (p + sizeof (int32_t)));
+			}
+			// cells out of a fixed board throw OutOfBounds (see handle)
+			session->board->update (cells, Board::Operation (operation));
+			frame (*session);
+			return true;
+		}
+		case RUN: {
+			if (!session->board || bytes != sizeof (int64_t)) {
+				return false;
+			}
+			const int64_t generations = load<int64_t> (payload);
+			if (generations < -1) {
+				return false;
+			}
+			session->remaining = generations;
+			schedule (session);
+			return true;
+		}
+		default:
+			return false;
+		}
+	}
+
+	/**
+	 * @brief writes as much of the pending frames as the socket takes (the session must be locked)
+	 * @param session the session
+	 * @return false if the connection failed
+	 **/
+	bool Server::flush (Session &session) {
+		while (!session.frames.empty()) {
+			const vector<char> &frame = session.frames.front();
+			ssize_t n = send (session.fd, frame.data() + session.written, frame.size() - session.written, MSG_NOSIGNAL);
+			if (n < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return errno == EAGAIN || errno == EWOULDBLOCK;
+			}
+			session.written += n;
+			if (session.written == frame.size()) {
+				session.frames.pop_front();
+				session.written = 0;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @brief ends a session and closes its connection (I/O thread only)
+	 * @param fd the connection
+	 **/
+	void Server::close (const int fd) {
+		auto found = sessions.find (fd);
+		if (found == sessions.end()) {
+			return;
+		}
+		{
+			lock_guard<mutex> lock (found->second->lock);
+			found->second->closed = true;
+			found->second->frames.clear();
+		}
+		sessions.erase (found);
+		::close (fd);
+	}
+
+	/**
+	 * @brief wakes the I/O thread
+	 **/
+	void Server::notify() {
+		char c = 0;
+		if (write (wake[1], &c, 1) < 0) {
+			// the pipe is full - the I/O thread is going to wake anyway
+		}
+	}
+}
@@ -0,0 +1,147 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+#include "Board.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// frames queued for a client before its session stops being stepped
+#define DEFAULT_MAX_PENDING_FRAMES 4
+// largest request accepted
+#define MAX_REQUEST_BYTES (64 << 20)
+// largest board a client may create (height * width)
+#define MAX_BOARD_CELLS (1LL << 28)
+
+namespace Life {
+	using std::string;
+	using std::vector;
+
+	/**
+	 * hosts many boards for clients on a Unix domain socket (or any connected stream socket).
+	 * every connection is a session with its own board. sessions are stepped by a shared pool
+	 * of workers, round robin one generation at a time, and every generation goes out as a frame.
+	 * a session with DEFAULT_MAX_PENDING_FRAMES frames not yet written to its client isn't
+	 * stepped until the client catches up, so slow clients don't cost CPU.
+	 *
+	 * requests (host byte order): uint32 type, uint32 payload bytes, payload
+	 *   CREATE - int32 height, int32 width, uint32 survival, uint32 birth: a new board (frame 0 follows)
+	 *   CELLS  - uint32 operation (Board::Operation), then (int32 row, int32 column) pairs (a frame follows)
+	 *   RUN    - int64 generations to run (-1 forever, 0 pauses)
+	 * frames: a FrameHeader, then header.words 64-bit words:
+	 *   FULL  - the packed rows (Board::getCells(): height rows of (width + 63) / 64 words)
+	 *   DELTA - the XOR with the previous frame, encoded as by History::encode
+	 * a malformed request closes the connection, as does one that fails (a board over MAX_BOARD_CELLS,
+	 * cells out of a fixed board, or memory running out) - the other sessions carry on.
+	 * a client may half-close its end: the requests it sent are still handled first, and the connection
+	 * is closed once the generations they asked for are run and all the frames are written.
+	 **/
+	class Server {
+	public:
+		enum Request : uint32_t { CREATE = 1, CELLS = 2, RUN = 3 };
+
+		enum FrameKind : uint32_t { FULL = 0, DELTA = 1 };
+
+		struct FrameHeader {
+			uint32_t magic;
+			uint32_t kind;
+			int64_t generation;
+			int32_t height, width;
+			// the coordinates of the top left cell (they move on growing boards)
+			int32_t top, left;
+			uint64_t words;
+		};
+
+		// "LIFE"
+		static const uint32_t MAGIC = 0x4546494C;
+	private:
+		typedef Matrix<bool>::word word;
+
+		struct Session {
+			int fd;
+			// guards everything below (the I/O thread and a worker may both use the session)
+			std::mutex lock;
+			std::unique_ptr<Board> board;
+			// the cells of the last frame, deltas are taken from it
+			Matrix<bool> sent;
+			long generation;
+			// generations still to run (-1 - forever)
+			long remaining;
+			// encoded frames not yet written, and how much of the first one was
+			std::deque<vector<char>> frames;
+			size_t written;
+			// in the ready queue (or being stepped)
+			bool queued;
+			bool closed;
+			// request bytes not parsed yet, and whether the client half-closed its end (I/O thread only)
+			vector<char> input;
+			bool ended;
+
+			explicit Session (const int);
+		};
+
+		int listener;
+		string path;
+		// the I/O thread is woken through this pipe
+		int wake[2];
+		size_t maxPending;
+		std::atomic<bool> stopping;
+
+		// I/O thread only
+		std::map<int, std::shared_ptr<Session>> sessions;
+		// attached from other threads, picked up by the I/O thread
+		std::mutex attaching;
+		vector<int> attached;
+
+		// sessions waiting for a worker, in order
+		std::mutex queueLock;
+		std::condition_variable queueReady;
+		std::deque<std::shared_ptr<Session>> ready;
+		vector<std::thread> workers;
+
+		void work();
+
+		void schedule (const std::shared_ptr<Session> &);
+
+		bool runnable (const Session &) const;
+
+		bool finished (const Session &) const;
+
+		void frame (Session &);
+
+		bool receive (const std::shared_ptr<Session> &);
+
+		bool handle (const std::shared_ptr<Session> &, const uint32_t, const char *, const size_t);
+
+		bool request (const std::shared_ptr<Session> &, const uint32_t, const char *, const size_t);
+
+		bool flush (Session &);
+
+		void close (const int);
+
+		void notify();
+	public:
+		Server (const string &, const int = 0, const size_t = DEFAULT_MAX_PENDING_FRAMES);
+
+		explicit Server (const int = 0, const size_t = DEFAULT_MAX_PENDING_FRAMES);
+
+		~Server();
+
+		Server (const Server &) = delete;
+		Server &operator= (const Server &) = delete;
+
+		void attach (const int);
+
+		void run();
+
+		void stop();
+	};
+}
+
+#endif
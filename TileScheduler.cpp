@@ -0,0 +1,278 @@
+#include "TileScheduler.h"
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+
+namespace Life {
+	using std::lock_guard;
+	using std::mutex;
+	using std::unique_lock;
+
+	/**
+	 * @brief returns the ratio of the busiest worker's work to the mean
+	 * @return 1 for a perfectly balanced run, the number of workers if one did everything
+	 **/
+	double TileScheduler::Statistics::imbalance() const {
+		long total = 0, busiest = 0;
+		for (long w : work) {
+			total += w;
+			busiest = std::max (busiest, w);
+		}
+		if (total == 0) {
+			return 1;
+		}
+		return double (busiest) * work.size() / total;
+	}
+
+	/**
+	 * @brief builds a scheduler and starts its threads
+	 * @param threads the number of workers, including the calling thread
+	 **/
+	TileScheduler::TileScheduler (const int threads) : generation (0), active (0), stopping (false), stealing (true),
+		pinned (false), callerCpu (-1), body (nullptr), pending (0) {
+		for (int i = 0; i < std::max (threads, 1); i++) {
+			workers.push_back (std::unique_ptr<Worker> (new Worker()));
+		}
+		for (int i = 1; i < threads; i++) {
+			this->threads.push_back (std::thread (&TileScheduler::loop, this, i));
+		}
+		statistics.tasks = statistics.splits = statistics.steals = 0;
+	}
+
+	TileScheduler::~TileScheduler() {
+		{
+			lock_guard<mutex> lock (wake);
+			stopping = true;
+		}
+		start.notify_all();
+		for (auto &t : threads) {
+			t.join();
+		}
+	}
+
+	/**
+	 * @brief runs the tiles (and whatever they are split into) and waits for all of them
+	 * if another run is in progress the tiles are run serially on the calling thread
+	 * @param tiles the initial tiles - dealt to the workers in contiguous runs
+	 * @param body the task
+	 * @param steal false keeps every tile on the worker it was dealt to (e.g. for first touch)
+	 **/
+	void TileScheduler::run (const vector<Tile> &tiles, const Body &body, const bool steal) {
+		unique_lock<mutex> guard (running, std::try_to_lock);
+		if (!guard.owns_lock()) {
+			serial (tiles, body);
+			return;
+		}
+		for (auto &w : workers) {
+			w->tasks = w->splits = w->steals = w->work = 0;
+		}
+#ifdef CPU_SET
+		// the calling thread is pinned for the run only, threads it starts later don't inherit the CPU
+		cpu_set_t callerMask;
+		const bool repin = callerCpu >= 0 && pthread_getaffinity_np (pthread_self(), sizeof (callerMask), &callerMask) == 0;
+		if (repin) {
+			cpu_set_t set;
+			CPU_ZERO (&set);
+			CPU_SET (callerCpu, &set);
+			pthread_setaffinity_np (pthread_self(), sizeof (set), &set);
+		}
+#endif
+		// deal the tiles out in contiguous runs, neighbouring tiles tend to cost the same
+		pending = tiles.size();
+		for (size_t i = 0; i < tiles.size(); i++) {
+			workers[i * workers.size() / tiles.size()]->tiles.push_back (tiles[i]);
+		}
+		{
+			lock_guard<mutex> lock (wake);
+			this->body = &body;
+			stealing = steal;
+			active = threads.size();
+			generation++;
+		}
+		start.notify_all();
+		work (0);
+		{
+			unique_lock<mutex> lock (wake);
+			finish.wait (lock, [this] {
+				return active == 0;
+			});
+			this->body = nullptr;
+		}
+#ifdef CPU_SET
+		if (repin) {
+			pthread_setaffinity_np (pthread_self(), sizeof (callerMask), &callerMask);
+		}
+#endif
+		statistics.tasks = statistics.splits = statistics.steals = 0;
+		statistics.work.clear();
+		for (auto &w : workers) {
+			statistics.tasks += w->tasks;
+			statistics.splits += w->splits;
+			statistics.steals += w->steals;
+			statistics.work.push_back (w->work);
+		}
+	}
+
+	/**
+	 * @brief runs the tiles depth first on the calling thread
+	 * @param tiles the initial tiles
+	 * @param body the task
+	 **/
+	void TileScheduler::serial (const vector<Tile> &tiles, const Body &body) {
+		vector<Tile> stack (tiles.rbegin(), tiles.rend());
+		vector<Tile> parts;
+		while (!stack.empty()) {
+			Tile tile = stack.back();
+			stack.pop_back();
+			parts.clear();
+			body (tile, parts);
+			stack.insert (stack.end(), parts.rbegin(), parts.rend());
+		}
+	}
+
+	/**
+	 * @brief the loop of a pool thread - waits for a run, works on it, reports
+	 * @param index the worker
+	 **/
+	void TileScheduler::loop (const int index) {
+		long seen = 0;
+		while (true) {
+			{
+				unique_lock<mutex> lock (wake);
+				start.wait (lock, [this, seen] {
+					return stopping || generation != seen;
+				});
+				if (stopping) {
+					return;
+				}
+				seen = generation;
+			}
+			work (index);
+			{
+				lock_guard<mutex> lock (wake);
+				if (--active == 0) {
+					finish.notify_one();
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief executes tiles until none are left in the run
+	 * @param index the worker
+	 **/
+	void TileScheduler::work (const int index) {
+		Worker &self = *workers[index];
+		vector<Tile> parts;
+		Tile tile;
+		bool stolen;
+		while (pending > 0) {
+			if (!take (index, tile, stolen)) {
+				std::this_thread::yield();
+				continue;
+			}
+			parts.clear();
+			self.work += (*body) (tile, parts);
+			self.tasks++;
+			if (stolen) {
+				self.steals++;
+			}
+			if (!parts.empty()) {
+				self.splits++;
+				// counted before this tile is retired, so pending never drops to 0 early
+				pending += parts.size();
+				lock_guard<mutex> lock (self.lock);
+				self.tiles.insert (self.tiles.end(), parts.rbegin(), parts.rend());
+			}
+			pending--;
+		}
+	}
+
+	/**
+	 * @brief takes a tile - the newest own one, or the oldest of another worker
+	 * @param index the worker
+	 * @param tile receives the tile
+	 * @param stolen set if the tile came from another worker
+	 * @return false if no tile was available
+	 **/
+	bool TileScheduler::take (const int index, Tile &tile, bool &stolen) {
+		{
+			Worker &self = *workers[index];
+			lock_guard<mutex> lock (self.lock);
+			if (!self.tiles.empty()) {
+				tile = self.tiles.back();
+				self.tiles.pop_back();
+				stolen = false;
+				return true;
+			}
+		}
+		for (size_t i = 1; stealing && i < workers.size(); i++) {
+			Worker &victim = *workers[ (index + i) % workers.size()];
+			lock_guard<mutex> lock (victim.lock);
+			if (!victim.tiles.empty()) {
+				tile = victim.tiles.front();
+				victim.tiles.pop_front();
+				stolen = true;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * @brief pins every worker to its own CPU (of the ones the process may use):
+	 * the pool threads to the second and next ones, and whichever thread calls run(), as worker 0,
+	 * to the first - for the duration of the run only, its own mask is restored afterwards
+	 * (so the threads it starts don't inherit a single CPU). does nothing where affinity isn't supported.
+	 * (the pinning lasts as long as the scheduler - on shared() it holds for every user of the process)
+	 **/
+	void TileScheduler::pin() {
+		if (pinned) {
+			return;
+		}
+		pinned = true;
+#ifdef CPU_SET
+		cpu_set_t allowed;
+		if (sched_getaffinity (0, sizeof (allowed), &allowed) != 0) {
+			return;
+		}
+		vector<int> cpus;
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET (cpu, &allowed)) {
+				cpus.push_back (cpu);
+			}
+		}
+		if (cpus.empty()) {
+			return;
+		}
+		callerCpu = cpus[0];
+		for (size_t i = 1; i < workers.size(); i++) {
+			cpu_set_t set;
+			CPU_ZERO (&set);
+			CPU_SET (cpus[i % cpus.size()], &set);
+			pthread_setaffinity_np (threads[i - 1].native_handle(), sizeof (set), &set);
+		}
+#endif
+	}
+
+	int TileScheduler::getThreads() const {
+		return workers.size();
+	}
+
+	/**
+	 * @brief returns the counters of the last run
+	 * @return the statistics
+	 **/
+	const TileScheduler::Statistics &TileScheduler::getStatistics() const {
+		return statistics;
+	}
+
+	/**
+	 * @brief the scheduler shared by all boards, with a worker per hardware thread
+	 * @return the scheduler
+	 **/
+	TileScheduler &TileScheduler::shared() {
+		static TileScheduler scheduler (std::max<int> (1, std::thread::hardware_concurrency()));
+		return scheduler;
+	}
+}
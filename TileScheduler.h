@@ -0,0 +1,99 @@
+#ifndef _TILE_SCHEDULER_H_
+#define _TILE_SCHEDULER_H_
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Life {
+	using std::vector;
+
+	/**
+	 * a rectangle of a bit-packed board: rows [row, row + height), words [word, word + words)
+	 **/
+	struct Tile {
+		int row, height, word, words;
+	};
+
+	/**
+	 * runs tile tasks on a pool of workers with work stealing
+	 * every worker owns a deque: it takes its own newest tile from the back,
+	 * an idle worker steals the oldest (largest) tile from the front of another.
+	 * a task may split its tile - the parts are pushed to the executing worker's deque.
+	 * the calling thread acts as worker 0, one run is scheduled at a time.
+	 **/
+	class TileScheduler {
+	public:
+		/**
+		 * runs a tile - either does its work and returns the amount done (e.g. cells),
+		 * or appends the parts it was split into
+		 **/
+		typedef std::function<long (const Tile &, vector<Tile> &)> Body;
+
+		// counters of a single run
+		struct Statistics {
+			long tasks, splits, steals;
+			// work done by every worker
+			vector<long> work;
+
+			double imbalance() const;
+		};
+	private:
+		struct Worker {
+			std::mutex lock;
+			std::deque<Tile> tiles;
+			long tasks, splits, steals, work;
+		};
+
+		vector<std::unique_ptr<Worker>> workers;
+		vector<std::thread> threads;
+		// held for the duration of a run
+		std::mutex running;
+		// wakes the threads for a run and reports when they are done
+		std::mutex wake;
+		std::condition_variable start, finish;
+		long generation;
+		int active;
+		bool stopping;
+		// idle workers may take tiles of others in the current run
+		bool stealing;
+		bool pinned;
+		// the CPU the calling thread (worker 0) is pinned to during a run, -1 if none
+		int callerCpu;
+		const Body *body;
+		// queued or executing tiles of the current run
+		std::atomic<long> pending;
+		Statistics statistics;
+
+		void loop (const int);
+
+		void work (const int);
+
+		bool take (const int, Tile &, bool &);
+	public:
+		explicit TileScheduler (const int);
+
+		~TileScheduler();
+
+		TileScheduler (const TileScheduler &) = delete;
+		TileScheduler &operator= (const TileScheduler &) = delete;
+
+		void run (const vector<Tile> &, const Body &, const bool = true);
+
+		void pin();
+
+		int getThreads() const;
+
+		const Statistics &getStatistics() const;
+
+		static void serial (const vector<Tile> &, const Body &);
+
+		static TileScheduler &shared();
+	};
+}
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace Matrix {
+	/**
+	 * source of matrix storage (a C++11 take on std::pmr::memory_resource)
+	 **/
+	class MemoryResource {
+	public:
+		virtual ~MemoryResource() {}
+
+		virtual void *allocate (const size_t bytes, const size_t alignment) = 0;
+
+		virtual void deallocate (void *p, const size_t bytes, const size_t alignment) = 0;
+
+		/**
+		 * checks if allocations come back zero-filled (users can skip clearing them)
+		 * @return true if zero-filled
+		 **/
+		virtual bool zeroes() const {
+			return false;
+		}
+	};
+
+	/**
+	 * plain operator new / delete
+	 **/
+	class NewDeleteResource : public MemoryResource {
+	public:
+		void *allocate (const size_t bytes, const size_t) override {
+			return ::operator new (bytes);
+		}
+
+		void deallocate (void *p, const size_t, const size_t) override {
+			::operator delete (p);
+		}
+	};
+
+	/**
+	 * the resource used when no arena is in scope
+	 * @return the new / delete resource
+	 **/
+	inline MemoryResource *defaultResource() {
+		static NewDeleteResource resource;
+		return &resource;
+	}
+
+	/**
+	 * the resource new matrices of the calling thread are allocated from
+	 * @return a reference to the thread's current resource
+	 **/
+	inline MemoryResource *&currentResource() {
+		static thread_local MemoryResource *current = defaultResource();
+		return current;
+	}
+
+	/**
+	 * monotonic arena - carves allocations out of large blocks by bumping a pointer.
+	 * deallocation is free: only the most recent allocation is given back,
+	 * everything else is released at once when the arena is destroyed (or release()d).
+	 * not thread-safe.
+	 **/
+	class Arena : public MemoryResource {
+		struct Block {
+			Block *next;
+			size_t size;
+		};
+
+		MemoryResource *upstream;
+		Block *blocks;
+		char *cursor, *end;
+		// size of the next block requested from upstream (grows geometrically)
+		size_t nextSize;
+		size_t used;
+
+		static char *align (char *p, const size_t alignment) {
+			uintptr_t address = reinterpret_cast<uintptr_t> (p);
+			return p + (alignment - address % alignment) % alignment;
+		}
+
+		void grow (const size_t bytes) {
+			size_t size = std::max (nextSize, bytes + sizeof (Block) + alignof (std::max_align_t));
+			Block *block = static_cast<Block *> (upstream->allocate (size, alignof (std::max_align_t)));
+			block->next = blocks;
+			block->size = size;
+			blocks = block;
+			cursor = reinterpret_cast<char *> (block + 1);
+			end = reinterpret_cast<char *> (block) + size;
+			nextSize = size * 2;
+		}
+	public:
+		/**
+		 * creates an empty arena (nothing is allocated until the first request)
+		 * @param initialSize size of the first block in bytes
+		 * @param upstream where the blocks come from
+		 **/
+		explicit Arena (const size_t initialSize = 64 << 10, MemoryResource *upstream = defaultResource()) :
+			upstream (upstream), blocks (nullptr), cursor (nullptr), end (nullptr), nextSize (initialSize), used (0) {
+		}
+
+		Arena (const Arena &) = delete;
+		Arena &operator= (const Arena &) = delete;
+
+		~Arena() {
+			release();
+		}
+
+		void *allocate (const size_t bytes, const size_t alignment) override {
+			char *p = align (cursor, alignment);
+			if (blocks == nullptr || bytes > size_t (end - p)) {
+				grow (bytes + alignment);
+				p = align (cursor, alignment);
+			}
+			cursor = p + bytes;
+			used += bytes;
+			return p;
+		}
+
+		void deallocate (void *p, const size_t bytes, const size_t) override {
+			// the last allocation (a temporary dying first) can be reused right away
+			if (static_cast<char *> (p) + bytes == cursor) {
+				cursor = static_cast<char *> (p);
+			}
+		}
+
+		/**
+		 * gives all the blocks back upstream
+		 * every matrix allocated from the arena must be gone by now
+		 **/
+		void release() {
+			while (blocks != nullptr) {
+				Block *next = blocks->next;
+				upstream->deallocate (blocks, blocks->size, alignof (std::max_align_t));
+				blocks = next;
+			}
+			cursor = end = nullptr;
+		}
+
+		/**
+		 * returns the total number of bytes handed out (freed ones included)
+		 * @return the bytes allocated
+		 **/
+		size_t getUsed() const {
+			return used;
+		}
+
+		/**
+		 * returns the number of bytes held in blocks
+		 * @return the bytes taken from upstream
+		 **/
+		size_t getCapacity() const {
+			size_t ret = 0;
+			for (Block *b = blocks; b != nullptr; b = b->next) {
+				ret += b->size;
+			}
+			return ret;
+		}
+	};
+
+	/**
+	 * an arena that is the calling thread's current resource for its lifetime:
+	 *
+	 *   Matrix<double> result (n, n);
+	 *   {
+	 *       ScopedArena arena;
+	 *       ... temporaries ...
+	 *       result = std::move (temporary); // copied out, result keeps its own storage
+	 *   }
+	 *
+	 * matrices created in the scope must not outlive it.
+	 **/
+	class ScopedArena {
+		Arena arena;
+		MemoryResource *previous;
+	public:
+		explicit ScopedArena (const size_t initialSize = 64 << 10) : arena (initialSize, currentResource()),
+			previous (currentResource()) {
+			currentResource() = &arena;
+		}
+
+		ScopedArena (const ScopedArena &) = delete;
+		ScopedArena &operator= (const ScopedArena &) = delete;
+
+		~ScopedArena() {
+			currentResource() = previous;
+		}
+
+		Arena &get() {
+			return arena;
+		}
+	};
+}
+
+#endif
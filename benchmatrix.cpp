@@ -0,0 +1,452 @@
+/**
+ * bench-matrix: times the matrix.h operations (operator*, det, inverse, rank, power, transpose)
+ * for int, double and bool square matrices, and compares runs.
+ *
+ * usage: bench-matrix [-o ops] [-t types] [-s sizes] [-m seconds] [-j threads]
+ *        bench-matrix [options] -c baseline [current] [-r percent]
+ * ops, types and sizes are comma separated lists (default: all, and 4,8,...,2048).
+ * results go to stdout, a tab separated line per measurement:
+ *   op type size reps ns allocs bytes gflops
+ * ns is the fastest of the repetitions (run until -m seconds, default 0.2, have passed),
+ * allocs / bytes the operator new calls per operation, and gflops uses the textbook operation count
+ * (2n^3 for a product, 2n^3/3 for an LU) - for bool, which works on 64 cells a word,
+ * in word operations (those counts over 64).
+ * before measuring, det, rank and inverse are checked on small (and fixed size) matrices with known results.
+ * the comparison reads a baseline (and the current results, or measures them with the options given)
+ * and flags every operation that got slower by more than -r percent (default 10) or allocates more -
+ * the exit status is 1 if any did.
+ **/
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "matrix.h"
+
+static std::atomic<long> allocations (0), allocatedBytes (0);
+
+// every allocation is counted (kept out of line, so the compiler doesn't pair malloc with delete)
+__attribute__ ((noinline)) void *operator new (size_t bytes) {
+	allocations++;
+	allocatedBytes += bytes;
+	if (void *p = std::malloc (bytes ? bytes : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void *operator new[] (size_t bytes) {
+	return operator new (bytes);
+}
+
+__attribute__ ((noinline)) void operator delete (void *p) noexcept {
+	std::free (p);
+}
+
+void operator delete[] (void *p) noexcept {
+	operator delete (p);
+}
+
+namespace Bench {
+	using ::Matrix::FixedMatrix;
+	using ::Matrix::Matrix;
+	using std::cerr;
+	using std::cout;
+	using std::endl;
+	using std::string;
+	using std::vector;
+
+	struct Result {
+		string op, type;
+		int size;
+		long reps;
+		double ns, allocs, bytes, gflops;
+	};
+
+	typedef std::tuple<string, string, int> Key;
+
+	static const char *header = "# op\ttype\tsize\treps\tns\tallocs\tbytes\tgflops";
+
+	static vector<string> split (const string &list) {
+		vector<string> ret;
+		std::stringstream s (list);
+		string item;
+		while (std::getline (s, item, ',')) {
+			if (!item.empty()) {
+				ret.push_back (item);
+			}
+		}
+		return ret;
+	}
+
+	/**
+	 * a well-conditioned matrix: uniform entries in [-1, 1] and n on the diagonal
+	 **/
+	static void sample (Matrix<double> &m, std::mt19937 &random) {
+		std::uniform_real_distribution<double> entry (-1, 1);
+		for (int i = 0; i < m.getHeight(); i++) {
+			for (int j = 0; j < m.getWidth(); j++) {
+				m (i, j) = entry (random) + (i == j ? m.getHeight() : 0);
+			}
+		}
+	}
+
+	/**
+	 * the unit matrix with random 0/1 entries on the superdiagonal: its determinant is 1,
+	 * and the minors, inverse and small powers stay small, so the exact (fraction-free) LU can't overflow
+	 **/
+	static void sample (Matrix<int> &m, std::mt19937 &random) {
+		for (int i = 0; i < m.getHeight(); i++) {
+			for (int j = 0; j < m.getWidth(); j++) {
+				m (i, j) = i == j || (j == i + 1 && (random() & 1));
+			}
+		}
+	}
+
+	/**
+	 * a random regular matrix over GF(2): the product of random unit lower and upper triangular matrices
+	 **/
+	static void sample (Matrix<bool> &m, std::mt19937 &random) {
+		const int n = m.getHeight();
+		Matrix<bool> lower (n, n), upper (n, n);
+		for (int i = 0; i < n; i++) {
+			for (int j = 0; j < n; j++) {
+				lower (i, j) = i == j || (i > j && (random() & 1));
+				upper (i, j) = i == j || (i < j && (random() & 1));
+			}
+		}
+		m = lower * upper;
+	}
+
+	template<class T> static Matrix<T> square (const int n, const std::initializer_list<T> values) {
+		Matrix<T> ret (n);
+		int k = 0;
+		for (const T &value : values) {
+			ret (k / n, k % n) = value;
+			k++;
+		}
+		return ret;
+	}
+
+	/**
+	 * checks det, rank and inverse against known results
+	 * @return false (after printing them) if any is wrong
+	 **/
+	static bool verify() {
+		vector<string> failed;
+		if (square<int> (2, {2, 1, 4, 3}).det() != 2) {
+			failed.push_back ("int det 2x2");
+		}
+		const Matrix<int> a = square<int> (3, {2, 0, 1, 1, 3, 2, 1, 1, 3});
+		if (a.det() != 12 || a.rank() != 3) {
+			failed.push_back ("int det/rank 3x3");
+		}
+		if (square<int> (3, {1, 2, 3, 2, 4, 6, 1, 1, 1}).rank() != 2) {
+			failed.push_back ("int rank of a singular 3x3");
+		}
+		const Matrix<int> inverse = square<int> (2, {2, 1, 1, 1}).inverse();
+		if (inverse (0, 0) != 1 || inverse (0, 1) != -1 || inverse (1, 0) != -1 || inverse (1, 1) != 2) {
+			failed.push_back ("int inverse 2x2");
+		}
+		try {
+			square<int> (2, {2, 0, 0, 2}).inverse();
+			failed.push_back ("int inverse that isn't integral");
+		} catch (const ::Matrix::NonRegularMatrix &) {
+		}
+		if (std::abs (square<double> (3, {2, 0, 1, 1, 3, 2, 1, 1, 3}).det() - 12) > 1e-9) {
+			failed.push_back ("double det 3x3");
+		}
+		// above 4x4 a FixedMatrix falls back to the (exact for int) LU
+		const FixedMatrix<int, 5, 5> fixed (-1, 1, 2, 3, 0, 0, 1, -2, -3, 2, 2, -2, 2, -2, 2, 2, 1, -2, -2, 2, 2, 3, -3, 0, 1);
+		if (fixed.det() != 36) {
+			failed.push_back ("int fixed det 5x5");
+		}
+		const FixedMatrix<int, 5, 5> unimodular (1, -1, 2, 0, 1, 2, -1, 5, -2, 2, -1, 2, 0, -1, -2, 0, 3, 1, -7, 4, 1, -1, 3, 0, -1);
+		if (unimodular.det() != 1 || ! (unimodular * unimodular.inverse() == FixedMatrix<int, 5, 5>::unitMatrix())) {
+			failed.push_back ("int fixed inverse 5x5");
+		}
+		try {
+			FixedMatrix<int, 2, 2> (2, 0, 0, 2).inverse();
+			failed.push_back ("int fixed inverse that isn't integral");
+		} catch (const ::Matrix::NonRegularMatrix &) {
+		}
+		for (const string &check : failed) {
+			cerr << "wrong result: " << check << endl;
+		}
+		return failed.empty();
+	}
+
+	template<class T> static Matrix<T> transposeOf (const Matrix<T> &m, const int threads) {
+		return m.transpose (threads);
+	}
+
+	static Matrix<bool> transposeOf (const Matrix<bool> &m, const int) {
+		return m.transpose();
+	}
+
+	template<class T> static double sink (const Matrix<T> &m) {
+		return m.getHeight() > 0 ? double (m (0, 0)) : 0;
+	}
+
+	static double sink (const double value) {
+		return value;
+	}
+
+	/**
+	 * runs an operation until minTime has passed (at least once, after a warm-up run).
+	 * fast operations are timed in batches of at least batchNs, so the clock doesn't dominate
+	 * @return false if the matrix is singular
+	 **/
+	static bool measure (const std::function<double() > &op, const double minTime, Result &result) {
+		typedef std::chrono::steady_clock Clock;
+		const double batchNs = 1e5;
+		volatile double keep = 0;
+		Clock::time_point begin = Clock::now();
+		try {
+			keep = keep + op();
+		} catch (const ::Matrix::NonRegularMatrix &) {
+			return false;
+		}
+		const double warmUp = std::chrono::duration<double, std::nano> (Clock::now() - begin).count();
+		const long batch = std::max (1L, long (batchNs / std::max (warmUp, 1.0)));
+		const long allocationsBefore = allocations, bytesBefore = allocatedBytes;
+		const Clock::time_point start = Clock::now();
+		double best = 0;
+		long reps = 0;
+		do {
+			begin = Clock::now();
+			for (long i = 0; i < batch; i++) {
+				keep = keep + op();
+			}
+			const double ns = std::chrono::duration<double, std::nano> (Clock::now() - begin).count() / batch;
+			best = reps == 0 ? ns : std::min (best, ns);
+			reps += batch;
+		} while (std::chrono::duration<double> (Clock::now() - start).count() < minTime);
+		result.reps = reps;
+		result.ns = best;
+		result.allocs = double (allocations - allocationsBefore) / reps;
+		result.bytes = double (allocatedBytes - bytesBefore) / reps;
+		return true;
+	}
+
+	template<class T> static void run (const string &type, const vector<string> &ops, const vector<int> &sizes,
+	                                   const double minTime, const int threads, vector<Result> &results) {
+		std::mt19937 random (12345);
+		for (int n : sizes) {
+			Matrix<T> a (n, n), b (n, n);
+			sample (a, random);
+			sample (b, random);
+			const double cube = double (n) * n * n;
+			for (const string &op : ops) {
+				std::function<double() > f;
+				double flops = 0;
+				if (op == "mul") {
+					f = [&a, &b] () {
+						return sink (a * b);
+					};
+					flops = 2 * cube;
+				} else if (op == "det") {
+					f = [&a] () {
+						return sink (double (a.det()));
+					};
+					flops = 2 * cube / 3;
+				} else if (op == "inverse") {
+					f = [&a] () {
+						return sink (a.inverse());
+					};
+					flops = 2 * cube;
+				} else if (op == "rank") {
+					f = [&a] () {
+						return sink (double (a.rank()));
+					};
+					flops = 2 * cube / 3;
+				} else if (op == "power") {
+					// a^3: a square and a product
+					f = [&a] () {
+						return sink (a.power (3));
+					};
+					flops = 4 * cube;
+				} else if (op == "transpose") {
+					f = [&a, threads] () {
+						return sink (transposeOf (a, threads));
+					};
+				} else {
+					cerr << "unknown operation " << op << endl;
+					exit (2);
+				}
+				Result result { op, type, n, 0, 0, 0, 0, 0 };
+				if (!measure (f, minTime, result)) {
+					cerr << op << ' ' << type << ' ' << n << ": singular matrix, skipped" << endl;
+					continue;
+				}
+				if (std::is_same<T, bool>::value) {
+					flops /= Matrix<bool>::wordBits;
+				}
+				result.gflops = flops / result.ns;
+				results.push_back (result);
+			}
+		}
+	}
+
+	static void print (std::ostream &out, const Result &r) {
+		out << r.op << '\t' << r.type << '\t' << r.size << '\t' << r.reps << '\t' << r.ns << '\t'
+		    << r.allocs << '\t' << r.bytes << '\t' << r.gflops << endl;
+	}
+
+	static bool load (const string &file, vector<Result> &results) {
+		std::ifstream in (file);
+		if (!in) {
+			cerr << "can't read " << file << endl;
+			return false;
+		}
+		string line;
+		while (std::getline (in, line)) {
+			if (line.empty() || line[0] == '#') {
+				continue;
+			}
+			std::istringstream fields (line);
+			Result r;
+			if (fields >> r.op >> r.type >> r.size >> r.reps >> r.ns >> r.allocs >> r.bytes >> r.gflops) {
+				results.push_back (r);
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * prints the operations measured in both runs with their change in time
+	 * @return the number of regressions
+	 **/
+	static int compare (const vector<Result> &baseline, const vector<Result> &current, const double threshold) {
+		std::map<Key, Result> old;
+		for (const Result &r : baseline) {
+			old[Key (r.op, r.type, r.size)] = r;
+		}
+		int regressions = 0;
+		cout << "# op\ttype\tsize\tbaseline_ns\tns\tchange%\tbaseline_allocs\tallocs\tstatus" << endl;
+		for (const Result &r : current) {
+			auto found = old.find (Key (r.op, r.type, r.size));
+			if (found == old.end()) {
+				continue;
+			}
+			const Result &b = found->second;
+			const double change = b.ns > 0 ? (r.ns - b.ns) / b.ns * 100 : 0;
+			const bool slower = change > threshold, allocating = r.allocs > b.allocs;
+			const char *status = slower ? "REGRESSION" : allocating ? "ALLOCATIONS" : change < -threshold ? "faster" : "ok";
+			if (slower || allocating) {
+				regressions++;
+			}
+			cout << r.op << '\t' << r.type << '\t' << r.size << '\t' << b.ns << '\t' << r.ns << '\t' << change << '\t'
+			     << b.allocs << '\t' << r.allocs << '\t' << status << endl;
+		}
+		cerr << regressions << " regression(s) beyond " << threshold << "%" << endl;
+		return regressions;
+	}
+
+	static void usage() {
+		cerr << "usage: bench-matrix [-o ops] [-t types] [-s sizes] [-m seconds] [-j threads]" << endl
+		     << "       bench-matrix [options] -c baseline [current] [-r percent]" << endl
+		     << "ops: mul,det,inverse,rank,power,transpose  types: int,double,bool  sizes: 4,8,...,2048" << endl;
+		exit (2);
+	}
+}
+
+using namespace Bench;
+
+int main (int argc, char **argv) {
+	vector<string> ops = split ("mul,det,inverse,rank,power,transpose"), types = split ("int,double,bool");
+	vector<int> sizes;
+	for (int n = 4; n <= 2048; n *= 2) {
+		sizes.push_back (n);
+	}
+	double minTime = 0.2, threshold = 10;
+	int threads = 1;
+	vector<string> files;
+	bool comparing = false;
+	for (int i = 1; i < argc; i++) {
+		const string option = argv[i];
+		if (option == "-c") {
+			comparing = true;
+			continue;
+		}
+		if (option[0] != '-') {
+			if (!comparing) {
+				usage();
+			}
+			files.push_back (option);
+			continue;
+		}
+		if (i + 1 == argc) {
+			usage();
+		}
+		const string value = argv[++i];
+		if (option == "-o") {
+			ops = split (value);
+		} else if (option == "-t") {
+			types = split (value);
+		} else if (option == "-s") {
+			sizes.clear();
+			for (const string &size : split (value)) {
+				sizes.push_back (std::max (1, atoi (size.c_str())));
+			}
+		} else if (option == "-m") {
+			minTime = atof (value.c_str());
+		} else if (option == "-j") {
+			threads = std::max (1, atoi (value.c_str()));
+		} else if (option == "-r") {
+			threshold = atof (value.c_str());
+		} else {
+			usage();
+		}
+	}
+	if (comparing && (files.empty() || files.size() > 2)) {
+		usage();
+	}
+	::Matrix::multiplyThreads() = threads;
+	cout.precision (10);
+	vector<Result> baseline, current;
+	if (comparing && !load (files[0], baseline)) {
+		return 2;
+	}
+	if (files.size() == 2) {
+		if (!load (files[1], current)) {
+			return 2;
+		}
+	} else {
+		if (!verify()) {
+			return 1;
+		}
+		for (const string &type : types) {
+			if (type == "int") {
+				run<int> (type, ops, sizes, minTime, threads, current);
+			} else if (type == "double") {
+				run<double> (type, ops, sizes, minTime, threads, current);
+			} else if (type == "bool") {
+				run<bool> (type, ops, sizes, minTime, threads, current);
+			} else {
+				cerr << "unknown type " << type << endl;
+				return 2;
+			}
+		}
+	}
+	if (comparing) {
+		return compare (baseline, current, threshold) > 0 ? 1 : 0;
+	}
+	cout << header << endl;
+	for (const Result &r : current) {
+		print (cout, r);
+	}
+	return 0;
+}
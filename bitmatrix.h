@@ -0,0 +1,1262 @@
+#ifndef _BITMATRIX_H
+#define _BITMATRIX_H
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <thread>
+#include <vector>
+#include "exceptions.h"
+#include "arena.h"
+#include "gemm.h"
+
+namespace Matrix {
+	template<class T> class Matrix;
+
+	/**
+	 * Matrix<bool> - a bit-packed matrix over GF(2)
+	 * each row is stored in 64-bit words (column c is bit c % 64 of word c / 64),
+	 * the bits past the width are always zero.
+	 * the rows are stored in bands of BAND_ROWS rows, reference counted and copied on write:
+	 * copying a matrix shares its bands (unless they come from another resource),
+	 * and a band is copied the first time a row of it is written through a non-const accessor.
+	 * word pointers and references into a matrix are invalidated by copying it.
+	 * addition is XOR, multiplication is AND, row operations work on whole words
+	 * and products use the Method of Four Russians.
+	 * cells are accessed through a proxy reference (like std::vector<bool>).
+	 **/
+	template<> class Matrix<bool> {
+	public:
+		typedef uint64_t word;
+		enum { wordBits = 64 };
+		// rows per band of storage
+		enum { BAND_SHIFT = 6, BAND_ROWS = 1 << BAND_SHIFT };
+	private:
+		// alignment of the storage
+		enum { CACHE_LINE = 64 };
+	public:
+
+		/**
+		 * reference to a single cell
+		 **/
+		class reference {
+			friend class Matrix<bool>;
+			word *w;
+			word mask;
+
+			reference (word *w, const word mask) : w (w), mask (mask) {}
+		public:
+			operator bool() const {
+				return (*w & mask) != 0;
+			}
+
+			reference &operator= (const bool value) {
+				if (value) {
+					*w |= mask;
+				} else {
+					*w &= ~mask;
+				}
+				return *this;
+			}
+
+			reference &operator= (const reference &r) {
+				return *this = bool (r);
+			}
+
+			reference &flip() {
+				*w ^= mask;
+				return *this;
+			}
+		};
+	private:
+		friend Matrix<bool> operator* (const Matrix<bool> &, const Matrix<bool> &);
+
+		/**
+		 * an allocation holding the words of one or more bands:
+		 * the header, the reference counts of the bands, then the words (from a cache line boundary).
+		 * it is freed when none of its bands is referenced any more
+		 **/
+		struct Block {
+			// bands still referenced
+			std::atomic<int> live;
+			int bands;
+			size_t bytes;
+			MemoryResource *resource;
+
+			static size_t headerBytes (const int bands) {
+				const size_t bytes = sizeof (Block) + bands * sizeof (std::atomic<int>);
+				return (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+			}
+
+			std::atomic<int> *references() {
+				return reinterpret_cast<std::atomic<int> *> (this + 1);
+			}
+
+			word *words() {
+				return reinterpret_cast<word *> (reinterpret_cast<char *> (this) + headerBytes (bands));
+			}
+		};
+
+		// BAND_ROWS rows (fewer in the last band) - the words, and the block they belong to
+		struct Band {
+			word *words;
+			Block *block;
+			int index;
+		};
+
+		// the bands (a matrix of a single band keeps it in place)
+		Band *bands;
+		Band single;
+		int height, width;
+		// words per row
+		int stride;
+		// where the words come from - fixed for the lifetime of the matrix
+		MemoryResource *resource;
+
+		bool checkRow (const int row) const {
+			return (0 <= row && row < height);
+		}
+
+		bool checkColumn (const int col) const {
+			return (0 <= col && col < width);
+		}
+
+		static int wordsFor (const int bitCount) {
+			return (bitCount + wordBits - 1) / wordBits;
+		}
+
+		static word bitMask (const int col) {
+			return word (1) << (col % wordBits);
+		}
+
+		/**
+		 * mask of the used bits in the last word of a row
+		 **/
+		word lastWordMask() const {
+			int used = width % wordBits;
+			return used == 0 ? ~word (0) : (word (1) << used) - 1;
+		}
+
+		int bandCount() const {
+			return (height + BAND_ROWS - 1) >> BAND_SHIFT;
+		}
+
+		int bandRows (const int band) const {
+			return std::min<int> (BAND_ROWS, height - (band << BAND_SHIFT));
+		}
+
+		Band *table() {
+			return bandCount() <= 1 ? &single : bands;
+		}
+
+		const Band *table() const {
+			return bandCount() <= 1 ? &single : bands;
+		}
+
+		static std::atomic<int> &references (const Band &band) {
+			return band.block->references() [band.index];
+		}
+
+		static bool isShared (const Band &band) {
+			return references (band).load (std::memory_order_acquire) > 1;
+		}
+
+		/**
+		 * allocates a block of bands, referenced once each
+		 * @param count the number of bands
+		 * @param words the words of all of them
+		 * @return the block
+		 **/
+		Block *allocate (const int count, const size_t words) const {
+			const size_t bytes = Block::headerBytes (count) + words * sizeof (word);
+			Block *block = new (resource->allocate (bytes, CACHE_LINE)) Block;
+			block->live.store (count, std::memory_order_relaxed);
+			block->bands = count;
+			block->bytes = bytes;
+			block->resource = resource;
+			for (int i = 0; i < count; i++) {
+				new (block->references() + i) std::atomic<int> (1);
+			}
+			if (!resource->zeroes()) {
+				std::fill (block->words(), block->words() + words, 0);
+			}
+			return block;
+		}
+
+		/**
+		 * drops a reference to a band, and frees its block if that was the last of them
+		 **/
+		static void release (const Band &band) {
+			if (references (band).fetch_sub (1, std::memory_order_acq_rel) == 1
+			        && band.block->live.fetch_sub (1, std::memory_order_acq_rel) == 1) {
+				band.block->resource->deallocate (band.block, band.block->bytes, CACHE_LINE);
+			}
+		}
+
+		/**
+		 * gives a shared band storage of its own
+		 * @param band the band
+		 * @param keep copies the words if true, zeroes them otherwise
+		 **/
+		void detach (const int band, const bool keep) {
+			Band &b = table() [band];
+			const size_t words = size_t (bandRows (band)) * stride;
+			Block *block = allocate (1, words);
+			if (keep) {
+				std::copy (b.words, b.words + words, block->words());
+			}
+			release (b);
+			b = Band { block->words(), block, 0 };
+		}
+
+		/**
+		 * allocates the band table and zeroed bands for the current size
+		 * (a resource handing out whole pages maps the bands together, others allocate a band each)
+		 **/
+		void allocateBands() {
+			const int count = bandCount();
+			if (count > 1) {
+				bands = static_cast<Band *> (resource->allocate (count * sizeof (Band), alignof (Band)));
+			}
+			Band *t = table();
+			if (resource->zeroes()) {
+				Block *block = allocate (count, size_t (height) * stride);
+				for (int k = 0; k < count; k++) {
+					t[k] = Band { block->words() + (size_t (k) << BAND_SHIFT) * stride, block, k };
+				}
+			} else {
+				for (int k = 0; k < count; k++) {
+					Block *block = allocate (1, size_t (bandRows (k)) * stride);
+					t[k] = Band { block->words(), block, 0 };
+				}
+			}
+		}
+
+		/**
+		 * resizes the matrix to a new size (removes the old one)
+		 * if the new size is 0x0, just deallocates everything
+		 * @param newHeight the new height
+		 * @param newWidth the new width
+		 **/
+		void resize (const int newHeight, const int newWidth) {
+			if (newHeight < 0 || newWidth < 0) {
+				throw InvalidSize();
+			}
+			if ( (newHeight == 0 || newWidth == 0) && newHeight + newWidth != 0) {
+				throw InvalidSize();
+			}
+			clear();
+			if (newHeight != 0 && newWidth != 0) {
+				stride = wordsFor (newWidth);
+				height = newHeight;
+				width = newWidth;
+				allocateBands();
+			}
+		}
+
+		/**
+		 * releases the bands, leaving the matrix withered (0*0)
+		 **/
+		void clear() {
+			const int count = bandCount();
+			const Band *t = table();
+			for (int k = 0; k < count; k++) {
+				release (t[k]);
+			}
+			if (count > 1) {
+				resource->deallocate (bands, count * sizeof (Band), alignof (Band));
+			}
+			bands = nullptr;
+			height = width = stride = 0;
+		}
+
+		/**
+		 * makes this matrix share the bands of m (a band from another resource is copied)
+		 * @param m the matrix to share with
+		 **/
+		void share (const Matrix &m) {
+			clear();
+			if (m.height == 0) {
+				return;
+			}
+			height = m.height;
+			width = m.width;
+			stride = m.stride;
+			const int count = bandCount();
+			if (count > 1) {
+				bands = static_cast<Band *> (resource->allocate (count * sizeof (Band), alignof (Band)));
+			}
+			Band *t = table();
+			const Band *source = m.table();
+			for (int k = 0; k < count; k++) {
+				if (source[k].block->resource == resource) {
+					t[k] = source[k];
+					references (t[k]).fetch_add (1, std::memory_order_relaxed);
+				} else {
+					const size_t words = size_t (bandRows (k)) * stride;
+					Block *block = allocate (1, words);
+					std::copy (source[k].words, source[k].words + words, block->words());
+					t[k] = Band { block->words(), block, 0 };
+				}
+			}
+		}
+
+		/**
+		 * takes over the storage of m, leaving it withered (0*0)
+		 * @param m the matrix to steal from
+		 **/
+		void steal (Matrix &m) {
+			if (resource != m.resource) {
+				// the band table of another resource can't be adopted - share the bands
+				share (m);
+				m.clear();
+				return;
+			}
+			clear();
+			bands = m.bands;
+			single = m.single;
+			height = m.height;
+			width = m.width;
+			stride = m.stride;
+			m.bands = nullptr;
+			m.height = m.width = m.stride = 0;
+		}
+
+		/**
+		 * swaps two rows in place
+		 **/
+		void swapRows (const int r1, const int r2) {
+			if (r1 != r2) {
+				std::swap_ranges (rowWords (r1), rowWords (r1) + stride, rowWords (r2));
+			}
+		}
+
+		/**
+		 * row destination ^= row source, starting at the given word
+		 **/
+		void xorRow (const int destination, const int source, const int fromWord = 0) {
+			word *target = rowWords (destination);
+			const word *row = rowWords (source);
+			for (int w = fromWord; w < stride; w++) {
+				target[w] ^= row[w];
+			}
+		}
+
+		/**
+		 * transposes a 64x64 bit block in place (a[i] bit j <-> a[j] bit i)
+		 **/
+		static void transposeBlock (word a[wordBits]) {
+			word m = 0x00000000FFFFFFFFULL;
+			for (int j = 32; j != 0; j >>= 1, m ^= m << j) {
+				for (int k = 0; k < wordBits; k = ( (k | j) + 1) & ~j) {
+					word t = ( (a[k] >> j) ^ a[k | j]) & m;
+					a[k] ^= t << j;
+					a[k | j] ^= t;
+				}
+			}
+		}
+
+		/**
+		 * gaussian elimination on whole words
+		 * @param companion if not null, receives the same row operations
+		 * @param reduce eliminates above the pivots too (reduced row echelon form)
+		 * @param swapCount counts the row swaps (by reference)
+		 * @return the rank
+		 **/
+		int eliminate (Matrix *companion, const bool reduce, int &swapCount) {
+			int row = 0;
+			swapCount = 0;
+			for (int col = 0; col < width && row < height; col++) {
+				const int w = col / wordBits;
+				const word mask = bitMask (col);
+				int pivot = row;
+				while (pivot < height && (static_cast<const Matrix *> (this)->rowWords (pivot) [w] & mask) == 0) {
+					pivot++;
+				}
+				if (pivot == height) {
+					continue;
+				}
+				if (pivot != row) {
+					swapRows (pivot, row);
+					if (companion != nullptr) {
+						companion->swapRows (pivot, row);
+					}
+					swapCount++;
+				}
+				for (int i = reduce ? 0 : row + 1; i < height; i++) {
+					if (i != row && (static_cast<const Matrix *> (this)->rowWords (i) [w] & mask) != 0) {
+						// the pivot row has no bits before col
+						xorRow (i, row, w);
+						if (companion != nullptr) {
+							companion->xorRow (i, row);
+						}
+					}
+				}
+				row++;
+			}
+			return row;
+		}
+
+		/**
+		 * C[r0:r1] ^= A[r0:r1] * B by the Method of Four Russians:
+		 * for each group of 8 rows of B, all 256 combinations are tabulated
+		 * (in Gray code order, one row XOR each) and every row of A
+		 * picks its combination with a single byte lookup
+		 **/
+		static void fourRussians (const Matrix &a, const Matrix &b, Matrix &c, const int r0, const int r1) {
+			const int stride = b.stride;
+			std::vector<word> table (256 * size_t (stride));
+			for (int g = 0; g < b.height; g += 8) {
+				const int combinations = 1 << std::min (8, b.height - g);
+				for (int i = 1; i < combinations; i++) {
+					word *entry = &table[i * size_t (stride)];
+					const word *previous = &table[ (i & (i - 1)) * size_t (stride)];
+					const word *row = b.rowWords (g + __builtin_ctz (i));
+					for (int w = 0; w < stride; w++) {
+						entry[w] = previous[w] ^ row[w];
+					}
+				}
+				const int w = g / wordBits;
+				const int shift = g % wordBits;
+				for (int i = r0; i < r1; i++) {
+					const unsigned index = (a.rowWords (i) [w] >> shift) & 0xFF;
+					if (index != 0) {
+						const word *entry = &table[index * size_t (stride)];
+						word *target = c.rowWords (i);
+						for (int k = 0; k < stride; k++) {
+							target[k] ^= entry[k];
+						}
+					}
+				}
+			}
+		}
+	public:
+		/**
+		 * creates a new h*w zero matrix
+		 * @param height
+		 * @param width
+		 **/
+		Matrix (const int height, const int width) : Matrix (height, width, currentResource()) {
+		}
+
+		/**
+		 * creates a new h*w zero matrix in the given resource
+		 * (by default matrices use the resource current on the creating thread)
+		 * @param height
+		 * @param width
+		 * @param resource where the words come from
+		 **/
+		Matrix (const int height, const int width, MemoryResource *resource) : bands (nullptr), height (0), width (0),
+			stride (0), resource (resource) {
+			resize (height, width);
+		}
+
+		/**
+		 * creates a size*size square zero matrix
+		 * @param size the size of the matrix
+		 **/
+		Matrix (const int size) : Matrix (size, size) {}
+
+		/**
+		 * copy constructor - shares the bands of m (copied on write)
+		 * @param m the matrix to copy
+		 **/
+		Matrix (const Matrix &m) : bands (nullptr), height (0), width (0), stride (0), resource (currentResource()) {
+			share (m);
+		}
+
+		/**
+		 * move constructor - takes over the storage of m
+		 * @param m the matrix to move from (left withered)
+		 **/
+		Matrix (Matrix &&m) : bands (nullptr), height (0), width (0), stride (0), resource (m.resource) {
+			steal (m);
+		}
+
+		/**
+		 * default c-tor - creates a withered (0*0) matrix
+		 **/
+		Matrix() : Matrix (0) {}
+
+		~Matrix() {
+			resize (0, 0);
+		}
+
+		/**
+		 * exchanges the contents - and the resources - of two matrices
+		 * @param m the other matrix
+		 **/
+		void swap (Matrix &m) {
+			std::swap (bands, m.bands);
+			std::swap (single, m.single);
+			std::swap (height, m.height);
+			std::swap (width, m.width);
+			std::swap (stride, m.stride);
+			std::swap (resource, m.resource);
+		}
+
+		int getWidth() const {
+			return width;
+		}
+
+		int getHeight() const {
+			return height;
+		}
+
+		/**
+		 * returns the number of words per row
+		 * @return the row stride in words
+		 **/
+		int getStride() const {
+			return stride;
+		}
+
+		/**
+		 * unchecked access to the words of a row
+		 * bits past the width must be kept zero
+		 * @param row the row
+		 * @return pointer to the first word of the row
+		 **/
+		word *rowWords (const int row) {
+			Band &band = table() [row >> BAND_SHIFT];
+			if (isShared (band)) {
+				detach (row >> BAND_SHIFT, true);
+			}
+			return band.words + size_t (row & (BAND_ROWS - 1)) * stride;
+		}
+
+		const word *rowWords (const int row) const {
+			return table() [row >> BAND_SHIFT].words + size_t (row & (BAND_ROWS - 1)) * stride;
+		}
+
+		/**
+		 * gives every band storage of its own (before rows are written from several threads)
+		 * @param keep keeps the contents if true, zeroes the matrix otherwise
+		 **/
+		void unshare (const bool keep = true) {
+			for (int k = 0; k < bandCount(); k++) {
+				if (isShared (table() [k])) {
+					detach (k, keep);
+				} else if (!keep) {
+					const Band &band = table() [k];
+					std::fill (band.words, band.words + size_t (bandRows (k)) * stride, 0);
+				}
+			}
+		}
+
+		/**
+		 * takes the bands of an earlier matrix of the same size back where they are shared
+		 * with others and equal to ours - so copies of a matrix keep sharing what they don't change
+		 * @param previous the earlier matrix
+		 **/
+		void shareUnchanged (const Matrix &previous) {
+			if (previous.height != height || previous.width != width) {
+				return;
+			}
+			Band *t = table();
+			const Band *p = previous.table();
+			for (int k = 0; k < bandCount(); k++) {
+				if (t[k].words != p[k].words && p[k].block->resource == resource && isShared (p[k])
+				        && std::equal (t[k].words, t[k].words + size_t (bandRows (k)) * stride, p[k].words)) {
+					references (p[k]).fetch_add (1, std::memory_order_relaxed);
+					release (t[k]);
+					t[k] = p[k];
+				}
+			}
+		}
+
+		/**
+		 * returns the number of bands shared with other matrices
+		 * @return the shared bands
+		 **/
+		int getSharedBands() const {
+			int shared = 0;
+			for (int k = 0; k < bandCount(); k++) {
+				shared += isShared (table() [k]);
+			}
+			return shared;
+		}
+
+		/**
+		 * returns the number of bands
+		 * @return the bands
+		 **/
+		int getBands() const {
+			return bandCount();
+		}
+
+		/**
+		 * returns the number of ones in the matrix
+		 * @return the population count
+		 **/
+		long count() const {
+			long ret = 0;
+			for (int i = 0; i < height; i++) {
+				const word *row = rowWords (i);
+				for (int w = 0; w < stride; w++) {
+					ret += __builtin_popcountll (row[w]);
+				}
+			}
+			return ret;
+		}
+
+		/**
+		 * returns a transposed copy of the matrix, 64x64 blocks at a time
+		 * @return a transposed version of the current matrix
+		 **/
+		Matrix transpose() const {
+			Matrix ret (width, height);
+			word block[wordBits];
+			for (int rb = 0; rb < height; rb += wordBits) {
+				const int rows = std::min<int> (wordBits, height - rb);
+				for (int wc = 0; wc < stride; wc++) {
+					for (int k = 0; k < wordBits; k++) {
+						block[k] = k < rows ? rowWords (rb + k) [wc] : 0;
+					}
+					transposeBlock (block);
+					const int cols = std::min<int> (wordBits, width - wc * wordBits);
+					for (int k = 0; k < cols; k++) {
+						ret.rowWords (wc * wordBits + k) [rb / wordBits] = block[k];
+					}
+				}
+			}
+			return ret;
+		}
+
+		/**
+		 * gets row vector
+		 * @param row the row
+		 * @return the row vector
+		 **/
+		Matrix getRow (const int row) const {
+			if (!checkRow (row)) {
+				throw OutOfBounds();
+			}
+			Matrix ret (width, 1);
+			for (int i = 0; i < width; i++) {
+				ret (i, 0) = (*this) (row, i);
+			}
+			return ret;
+		}
+
+		/**
+		 * gets column vector
+		 * @param col the column
+		 * @return the column vector
+		 **/
+		Matrix getColumn (const int col) const {
+			if (!checkColumn (col)) {
+				throw OutOfBounds();
+			}
+			Matrix ret (height, 1);
+			for (int i = 0; i < height; i++) {
+				ret (i, 0) = (*this) (i, col);
+			}
+			return ret;
+		}
+
+		/**
+		 * checks if the matrix is square
+		 * @return true if square matrix
+		 **/
+		bool isSquare() const {
+			return (width == height);
+		}
+
+		/**
+		 * gets a minor of the matrix
+		 * @param row row to remove
+		 * @param col column to remove
+		 * @return minor of the matrix
+		 **/
+		Matrix getMinor (const int row, const int col) const {
+			if (!isSquare()) {
+				throw NonSquareMatrix();
+			}
+			if (!checkColumn (col) || !checkRow (row)) {
+				throw OutOfBounds();
+			}
+			Matrix ret (height - 1, width - 1);
+			for (int i = 0, targetI = 0; i < height; i++) {
+				if (i == row) {
+					continue;
+				}
+				for (int j = 0, targetJ = 0; j < width; j++) {
+					if (j == col) {
+						continue;
+					}
+					ret (targetI, targetJ++) = (*this) (i, j);
+				}
+				targetI++;
+			}
+			return ret;
+		}
+
+		/**
+		 * returns the determinant of the matrix (over GF(2))
+		 * @return the determinant
+		 **/
+		bool det() const {
+			if (!isSquare()) {
+				throw NonSquareMatrix();
+			}
+			return rank() == height;
+		}
+
+		/**
+		 * gets the inverse of the matrix
+		 * @return the inverse of the matrix
+		 **/
+		Matrix inverse() const {
+			if (!isSquare()) {
+				throw NonSquareMatrix();
+			}
+			Matrix reduced (*this);
+			Matrix ret = unitMatrix (width);
+			int swapCount;
+			if (reduced.eliminate (&ret, true, swapCount) < height) {
+				throw NonRegularMatrix();
+			}
+			return ret;
+		}
+
+		/**
+		 * returns the trace of the matrix
+		 * @return the trace
+		 **/
+		bool trace() const {
+			if (!isSquare()) {
+				throw NonSquareMatrix();
+			}
+			bool sum = false;
+			for (int i = 0; i < height; i++) {
+				sum ^= (*this) (i, i);
+			}
+			return sum;
+		}
+
+		/**
+		 * swaps two rows of the matrix
+		 * @param r1 row 1
+		 * @param r2 row 2
+		 * @return the matrix with the swapped rows
+		 **/
+		Matrix rowSwap (const int r1, const int r2) const {
+			if (!checkRow (r1) || !checkRow (r2)) {
+				throw OutOfBounds();
+			}
+			Matrix ret (*this);
+			ret.swapRows (r1, r2);
+			return ret;
+		}
+
+		/**
+		 * multiplies a row by the given scalar
+		 * @param r the row
+		 * @param s the scalar
+		 * @return the matrix with row r multiplied by s
+		 **/
+		Matrix rowMultiply (const int r, const bool s) const {
+			if (!checkRow (r)) {
+				throw OutOfBounds();
+			}
+			Matrix ret (*this);
+			if (!s) {
+				std::fill (ret.rowWords (r), ret.rowWords (r) + stride, 0);
+			}
+			return ret;
+		}
+
+		/**
+		 * adds a row with a multiplication of another row
+		 * @param destination the destination row
+		 * @param source the source row
+		 * @param s the scalar to multiply by. default is 1
+		 * @return the matrix with a row added by a multiplication of another row
+		 **/
+		Matrix rowAddMultiply (const int destination, const int source, const bool s = true) const {
+			if (!checkRow (destination) || !checkRow (source)) {
+				throw OutOfBounds();
+			}
+			Matrix ret (*this);
+			if (s) {
+				ret.xorRow (destination, source);
+			}
+			return ret;
+		}
+
+		/**
+		 * adds a column with a multiplication of another column
+		 * @param destination the destination column
+		 * @param source the source column
+		 * @param s the scalar to multiply by
+		 * @return the matrix with a column added by a multiplication of another column
+		 **/
+		Matrix colAddMultiply (const int destination, const int source, const bool s) const {
+			if (!checkColumn (destination) || !checkColumn (source)) {
+				throw OutOfBounds();
+			}
+			Matrix ret (*this);
+			if (s) {
+				for (int i = 0; i < height; i++) {
+					ret (i, destination) = ret (i, destination) != ret (i, source);
+				}
+			}
+			return ret;
+		}
+
+		/**
+		 * multiplies a column by the given scalar
+		 * @param c the column
+		 * @param s the scalar
+		 * @return the matrix with column c multiplied by s
+		 **/
+		Matrix colMultiply (const int c, const bool s) const {
+			if (!checkColumn (c)) {
+				throw OutOfBounds();
+			}
+			Matrix ret (*this);
+			if (!s) {
+				for (int i = 0; i < height; i++) {
+					ret (i, c) = false;
+				}
+			}
+			return ret;
+		}
+
+		/**
+		 * swaps two columns
+		 * @param c1 the first column
+		 * @param c2 the second column
+		 * @return the matrix with the two columns swapped
+		 **/
+		Matrix colSwap (const int c1, const int c2) const {
+			if (!checkColumn (c1) || !checkColumn (c2)) {
+				throw OutOfBounds();
+			}
+			Matrix ret (*this);
+			for (int i = 0; i < height; i++) {
+				bool b = ret (i, c1);
+				ret (i, c1) = bool (ret (i, c2));
+				ret (i, c2) = b;
+			}
+			return ret;
+		}
+
+		/**
+		 * returns the matrix powered by r, by repeated squaring
+		 * works only for square matrices, throws NonSquareMatrix otherwise
+		 * if M is singular, throws NonRegularMatrix for r <= 0
+		 * @param r the exponent
+		 * @return M^r
+		 **/
+		Matrix power (const long r) const {
+			if (!isSquare()) {
+				throw NonSquareMatrix();
+			}
+			Matrix base = r <= 0 ? inverse() : *this; // will throw NonRegularMatrix on failure
+			unsigned long exponent = r < 0 ? 0UL - (unsigned long) r : (unsigned long) r;
+			Matrix ret = unitMatrix (width);
+			while (exponent > 0) {
+				if (exponent & 1) {
+					ret = ret * base;
+				}
+				exponent >>= 1;
+				if (exponent > 0) {
+					base = base * base;
+				}
+			}
+			return ret;
+		}
+
+		/**
+		 * returns the matrix after gaussian elimination
+		 * @param canonical returns a reduced row echelon form if true, a row echelon form otherwise
+		 * @return the matrix after gaussian elimination
+		 **/
+		Matrix gaussianElimination (const bool canonical = false) const {
+			Matrix b;
+			return gaussianElimination (b, canonical);
+		}
+
+		/**
+		 * returns the matrix after gaussian elimination
+		 * @param inverse the matrix which will become inversed (if there's an inverse)
+		 * @param canonical returns a reduced row echelon form if true, a row echelon form otherwise
+		 * @return the matrix after gaussian elimination
+		 **/
+		Matrix gaussianElimination (Matrix &inverse, const bool canonical = false) const {
+			int a;
+			return gaussianElimination (a, inverse, canonical);
+		}
+
+		/**
+		 * returns the matrix after gaussian elimination
+		 * @param swapCount counts how many swaps were during the elimination (by reference)
+		 * @param inverse will become the inverse of the matrix (by reference)
+		 * 	if non-square or non-canonical - not touched. if singular - a 0*0 matrix
+		 * @param canonical returns a reduced row echelon form if true, a row echelon form otherwise
+		 * @return the matrix after gaussian elimination
+		 **/
+		Matrix gaussianElimination (int &swapCount, Matrix &inverse, const bool canonical = false) const {
+			Matrix ret (*this);
+			bool hasInverse = canonical && isSquare();
+			if (hasInverse) {
+				inverse = unitMatrix (width);
+			}
+			int rank = ret.eliminate (hasInverse ? &inverse : nullptr, canonical, swapCount);
+			if (hasInverse && rank < height) {
+				inverse = Matrix (0);
+			}
+			return ret;
+		}
+
+		/**
+		 * returns the rank of the matrix
+		 * @return rank of the matrix
+		 **/
+		int rank() const {
+			Matrix reduced (*this);
+			int swapCount;
+			return reduced.eliminate (nullptr, false, swapCount);
+		}
+
+		/* static functions **/
+		/**
+		 * returns the unit matrix
+		 * @param size the size of the unit matrix
+		 * @return I(n*n)
+		 **/
+		static Matrix unitMatrix (const int size) {
+			return scalarMatrix (size, true);
+		}
+
+		/**
+		 * returns a scalar matrix
+		 * @param size size
+		 * @param s the scalar
+		 * @return sI
+		 **/
+		static Matrix scalarMatrix (const int size, const bool s) {
+			Matrix ret (size);
+			if (s) {
+				for (int i = 0; i < size; i++) {
+					ret.rowWords (i) [i / wordBits] |= bitMask (i);
+				}
+			}
+			return ret;
+		}
+
+		/**
+		 * returns a jordan block
+		 * @param size the size of the block
+		 * @param s the value of the diagonal
+		 * @return the jordan block
+		 **/
+		static Matrix jordanBlock (const int size, const bool s) {
+			Matrix ret = scalarMatrix (size, s);
+			for (int i = 1; i < size; i++) {
+				ret (i - 1, i) = true;
+			}
+			return ret;
+		}
+
+		/**
+		 * returns a full matrix (a matrix in which all the fields have the same value
+		 * @param height the height of the matrix
+		 * @param width the width of the matrix
+		 * @param s the value of each cell
+		 * @return a full matrix with the given size and value
+		 **/
+		static Matrix fullMatrix (const int height, const int width, const bool s) {
+			Matrix ret (height, width);
+			if (s) {
+				ret += true;
+			}
+			return ret;
+		}
+
+		/* operators **/
+		/**
+		 * gets the value at (i,j)
+		 * @param row row
+		 * @param col column
+		 * @return the value at (i,j)
+		 **/
+		bool operator() (const int row, const int col) const {
+			if (!checkColumn (col) || !checkRow (row)) {
+				throw OutOfBounds();
+			}
+			return (rowWords (row) [col / wordBits] & bitMask (col)) != 0;
+		}
+
+		reference operator() (const int row, const int col) {
+			if (!checkColumn (col) || !checkRow (row)) {
+				throw OutOfBounds();
+			}
+			return reference (rowWords (row) + col / wordBits, bitMask (col));
+		}
+
+		/**
+		 * matrix comparison
+		 * @param m the matrix to compare
+		 * @return true if they're equal
+		 **/
+		bool operator== (const Matrix &m) const {
+			if (this == &m) {
+				return true;
+			}
+			if (width != m.width || height != m.height) {
+				throw SizeMismatch();
+			}
+			const Band *t = table(), *o = m.table();
+			for (int k = 0; k < bandCount(); k++) {
+				if (t[k].words != o[k].words && !std::equal (t[k].words, t[k].words + size_t (bandRows (k)) * stride, o[k].words)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		/**
+		 * matrix !=
+		 * @param m the matrix to compare with
+		 * @return true if not equal
+		 **/
+		bool operator!= (const Matrix &m) const {
+			return ! (*this == m);
+		}
+
+		/**
+		 * copy assignment - shares the bands of m (copied on write)
+		 **/
+		Matrix &operator= (const Matrix &m) {
+			if (this != &m) {
+				share (m);
+			}
+			return *this;
+		}
+
+		/**
+		 * move assignment - takes over the storage of m
+		 **/
+		Matrix &operator= (Matrix &&m) {
+			if (this != &m) {
+				steal (m);
+			}
+			return *this;
+		}
+
+		/**
+		 * matrix += (XOR)
+		 **/
+		Matrix &operator+= (const Matrix &m) {
+			if (width != m.width || height != m.height) {
+				throw SizeMismatch();
+			}
+			for (int i = 0; i < height; i++) {
+				word *row = rowWords (i);
+				const word *source = m.rowWords (i);
+				for (int w = 0; w < stride; w++) {
+					row[w] ^= source[w];
+				}
+			}
+			return *this;
+		}
+
+		/**
+		 * scalar += - adds s to every entry
+		 **/
+		Matrix &operator+= (const bool s) {
+			if (s) {
+				for (int i = 0; i < height; i++) {
+					word *row = rowWords (i);
+					for (int w = 0; w < stride; w++) {
+						row[w] = ~row[w];
+					}
+					row[stride - 1] &= lastWordMask();
+				}
+			}
+			return *this;
+		}
+
+		/**
+		 * matrix -= (same as += over GF(2))
+		 **/
+		Matrix &operator-= (const Matrix &m) {
+			return *this += m;
+		}
+
+		/**
+		 * scalar *=
+		 **/
+		Matrix &operator*= (const bool s) {
+			if (!s) {
+				unshare (false);
+			}
+			return *this;
+		}
+
+		/**
+		 * matrix *=
+		 * will throw exception on size mismatch
+		 * @param m the matrix to multiply with
+		 * @return this*m
+		 **/
+		Matrix &operator*= (const Matrix &m);
+
+		/**
+		 * returns the negative of the matrix (itself, over GF(2))
+		 * @return -matrix
+		 **/
+		Matrix operator-() const {
+			return *this;
+		}
+	};
+
+	/**
+	 * GF(2) matrix multiplication (Method of Four Russians)
+	 * large products are split into row bands, one per thread
+	 * @param m1 matrix 1
+	 * @param m2 matrix 2
+	 * @return the multiplication of the two matrices
+	 **/
+	inline Matrix<bool> operator* (const Matrix<bool> &m1, const Matrix<bool> &m2) {
+		if (m1.getWidth() != m2.getHeight()) {
+			throw SizeMismatch();
+		}
+		Matrix<bool> ret (m1.getHeight(), m2.getWidth());
+		const int height = m1.getHeight();
+		if (height == 0 || m1.getWidth() == 0) {
+			return ret;
+		}
+		// each thread tabulates its own combinations, so give it enough rows to pay for them
+		int threads = std::min (multiplyThreads(), height / 1024);
+		if (threads <= 1) {
+			Matrix<bool>::fourRussians (m1, m2, ret, 0, height);
+			return ret;
+		}
+		int band = (height + threads - 1) / threads;
+		std::vector<std::thread> workers;
+		for (int r0 = band; r0 < height; r0 += band) {
+			workers.push_back (std::thread (Matrix<bool>::fourRussians, std::cref (m1), std::cref (m2),
+			                                std::ref (ret), r0, std::min (r0 + band, height)));
+		}
+		Matrix<bool>::fourRussians (m1, m2, ret, 0, std::min (band, height));
+		for (auto &w : workers) {
+			w.join();
+		}
+		return ret;
+	}
+
+	inline Matrix<bool> &Matrix<bool>::operator*= (const Matrix<bool> &m) {
+		*this = *this * m;
+		return *this;
+	}
+
+	/**
+	 * GF(2) matrix addition (XOR)
+	 * @param m1 matrix 1
+	 * @param m2 matrix 2
+	 * @return m1+m2
+	 **/
+	inline Matrix<bool> operator+ (const Matrix<bool> &m1, const Matrix<bool> &m2) {
+		Matrix<bool> ret (m1);
+		ret += m2;
+		return ret;
+	}
+
+	/**
+	 * GF(2) matrix substraction (same as addition)
+	 * @param m1 matrix 1
+	 * @param m2 matrix 2
+	 * @return m1-m2
+	 **/
+	inline Matrix<bool> operator- (const Matrix<bool> &m1, const Matrix<bool> &m2) {
+		return m1 + m2;
+	}
+
+	/**
+	 * adds s to each entry
+	 * @param m the matrix
+	 * @param s the scalar
+	 * @return m with s added to each entry
+	 **/
+	inline Matrix<bool> operator+ (const Matrix<bool> &m, const bool s) {
+		Matrix<bool> ret (m);
+		ret += s;
+		return ret;
+	}
+
+	inline Matrix<bool> operator+ (const bool s, const Matrix<bool> &m) {
+		return m + s;
+	}
+
+	inline Matrix<bool> operator- (const Matrix<bool> &m, const bool s) {
+		return m + s;
+	}
+
+	inline Matrix<bool> operator- (const bool s, const Matrix<bool> &m) {
+		return m + s;
+	}
+
+	/**
+	 * multiplies each entry by s
+	 * @param m the matrix
+	 * @param s the scalar
+	 * @return m*s
+	 **/
+	inline Matrix<bool> operator* (const Matrix<bool> &m, const bool s) {
+		Matrix<bool> ret (m);
+		ret *= s;
+		return ret;
+	}
+
+	inline Matrix<bool> operator* (const bool s, const Matrix<bool> &m) {
+		return m * s;
+	}
+
+	/**
+	 * matrix-scalar comparison
+	 * works only for square matrices
+	 * @param m the matrix
+	 * @param s the scalar to compare with
+	 * @return m == sI
+	 **/
+	inline bool operator== (const Matrix<bool> &m, const bool s) {
+		return m == Matrix<bool>::scalarMatrix (m.getWidth(), s);
+	}
+
+	inline bool operator== (const bool s, const Matrix<bool> &m) {
+		return m == s;
+	}
+
+	inline bool operator!= (const Matrix<bool> &m, const bool s) {
+		return ! (m == s);
+	}
+
+	inline bool operator!= (const bool s, const Matrix<bool> &m) {
+		return ! (m == s);
+	}
+
+	/**
+	 * outputs a matrix
+	 * @param fd the output stream
+	 * @param m the matrix to print
+	 * @return reference to fd
+	 **/
+	inline std::ostream &operator<< (std::ostream &fd, const Matrix<bool> &m) {
+		for (int i = 0; i < m.getHeight(); i++) {
+			for (int j = 0; j < m.getWidth(); j++) {
+				fd << m (i, j) << " ";
+			}
+			fd << std::endl;
+		}
+		return fd;
+	}
+}
+
+#endif
@@ -0,0 +1,420 @@
+/**
+ * check: small deterministic checks of the paths the demo and bench-matrix don't exercise -
+ * the exact integer LU and the FixedMatrix fallbacks, copy-on-write blits across band boundaries,
+ * EditQueue and FrameRing under contention, History and Exporter round trips, and a server
+ * client that half-closes its end.
+ *
+ * usage: check
+ * every failed check is printed, the exit status is 1 if any failed.
+ **/
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "Board.h"
+#include "EditQueue.h"
+#include "Exporter.h"
+#include "FrameRing.h"
+#include "History.h"
+#include "Server.h"
+
+namespace Check {
+	using ::Matrix::FixedMatrix;
+	using ::Matrix::Matrix;
+	using ::Matrix::NonRegularMatrix;
+	using ::Matrix::OutOfBounds;
+	using Life::Board;
+	using Life::EditQueue;
+	using Life::Exporter;
+	using Life::FrameRing;
+	using Life::History;
+	using Life::Server;
+	using std::cerr;
+	using std::endl;
+	using std::pair;
+	using std::string;
+	using std::vector;
+
+	static vector<string> failed;
+
+	static void expect (const bool ok, const string &check) {
+		if (!ok) {
+			failed.push_back (check);
+		}
+	}
+
+	/**
+	 * a random board, about a third alive
+	 **/
+	static Board soup (const int height, const int width, std::mt19937 &random) {
+		Board b (height, width);
+		vector<pair<int, int>> cells;
+		for (int r = 0; r < height; r++) {
+			for (int c = 0; c < width; c++) {
+				if (random() % 3 == 0) {
+					cells.push_back (std::make_pair (r, c));
+				}
+			}
+		}
+		b.update (cells);
+		return b;
+	}
+
+	/**
+	 * det of an empty matrix, integer inverses that aren't integral, FixedMatrix above 4x4
+	 **/
+	static void matrices() {
+		expect (Matrix<int>().det() == 1, "int det of a 0x0 matrix");
+		expect (Matrix<double> (0).det() == 1, "double det of a 0x0 matrix");
+		Matrix<int> twice (2);
+		twice (0, 0) = 2;
+		twice (1, 1) = 2;
+		try {
+			twice.inverse();
+			failed.push_back ("int inverse that isn't integral");
+		} catch (const NonRegularMatrix &) {
+		}
+		try {
+			FixedMatrix<int, 2, 2> (2, 0, 0, 2).inverse();
+			failed.push_back ("int fixed inverse that isn't integral");
+		} catch (const NonRegularMatrix &) {
+		}
+		// an integral solution is exact even though det isn't 1
+		Matrix<int> right (2);
+		right (0, 0) = 4;
+		right (1, 1) = -6;
+		const Matrix<int> x = twice.lu().solve (right);
+		expect (x (0, 0) == 2 && x (0, 1) == 0 && x (1, 0) == 0 && x (1, 1) == -3, "int solve with det 4");
+		const FixedMatrix<int, 5, 5> fixed (-1, 1, 2, 3, 0, 0, 1, -2, -3, 2, 2, -2, 2, -2, 2, 2, 1, -2, -2, 2, 2, 3, -3, 0, 1);
+		expect (fixed.det() == 36, "int fixed det 5x5");
+		const FixedMatrix<int, 5, 5> unimodular (1, -1, 2, 0, 1, 2, -1, 5, -2, 2, -1, 2, 0, -1, -2, 0, 3, 1, -7, 4, 1, -1, 3, 0,
+		        -1);
+		expect (unimodular * unimodular.inverse() == FixedMatrix<int, 5, 5>::unitMatrix(), "int fixed inverse 5x5");
+	}
+
+	/**
+	 * blits into copies sharing their bands, across the boundary of two bands:
+	 * the original keeps its cells, the copy gets exactly the blitted ones
+	 **/
+	static void blits() {
+		std::mt19937 random (1);
+		const int boundary = Matrix<bool>::BAND_ROWS;
+		const Board original = soup (3 * boundary, 150, random);
+		const uint64_t before = original.hash();
+		Matrix<bool> stamp (20, 70);
+		for (int i = 0; i < stamp.getHeight(); i++) {
+			for (int j = 0; j < stamp.getWidth(); j++) {
+				stamp (i, j) = random() % 2 == 0;
+			}
+		}
+		Board toggled = original;
+		toggled.blit (stamp, boundary - 10, 30, Board::TOGGLE);
+		// the self blit overlaps its source, on the other side of the boundary
+		Board moved = original;
+		moved.blit (moved, boundary - 14, 10, 30, 100, boundary - 4, 20);
+		bool toggledRight = true, movedRight = true;
+		for (int r = 0; r < original.getHeight(); r++) {
+			for (int c = 0; c < original.getWidth(); c++) {
+				const bool inStamp = r >= boundary - 10 && r < boundary + 10 && c >= 30 && c < 100;
+				toggledRight = toggledRight && toggled (r, c) == (original (r, c) != (inStamp && stamp (r - boundary + 10,
+				               c - 30)));
+				const bool inMoved = r >= boundary - 4 && r < boundary + 26 && c >= 20 && c < 120;
+				movedRight = movedRight && moved (r, c) == (inMoved ? original (r - 10, c - 10) : original (r, c));
+			}
+		}
+		expect (toggledRight, "toggling blit over a band boundary of a copy");
+		expect (movedRight, "overlapping self blit over a band boundary of a copy");
+		expect (original.hash() == before, "the original of blitted copies");
+	}
+
+	/**
+	 * producers submitting edits while the board steps (on the event engine, which follows them):
+	 * every edit is applied once, in the order of its producer, and those out of the board are rejected
+	 **/
+	static void edits() {
+		const int producers = 4, cells = 1000, pairs = 100, outside = 5;
+		// nothing is born and everything survives - the board only changes by the edits
+		Board b (producers * 64, 256, 0x1FF, 0);
+		b.setEngine (Board::EVENTS);
+		EditQueue queue;
+		b.setEdits (&queue);
+		vector<std::thread> threads;
+		for (int p = 0; p < producers; p++) {
+			threads.push_back (std::thread ([&queue, p] () {
+				for (int i = 0; i < cells; i++) {
+					queue.submit (p * 64 + i / 32, i % 32, Board::SET);
+					if (i < pairs) {
+						// set, then cleared - it stays dead if they are applied in order
+						queue.submit (p * 64 + 40 + i / 32, i % 32, Board::SET);
+						queue.submit (p * 64 + 40 + i / 32, i % 32, Board::CLEAR);
+					}
+					if (i < outside) {
+						queue.submit (-1, i, Board::SET);
+					}
+				}
+			}));
+		}
+		const long total = producers * (cells + 2 * pairs + outside);
+		while (true) {
+			b.step();
+			const EditQueue::Statistics s = queue.getStatistics();
+			if (s.edits + s.rejected == total) {
+				break;
+			}
+			std::this_thread::yield();
+		}
+		for (auto &t : threads) {
+			t.join();
+		}
+		b.step();
+		const EditQueue::Statistics s = queue.getStatistics();
+		expect (s.edits == producers * (cells + 2 * pairs) && s.rejected == producers * outside, "edits counted");
+		Board expected (producers * 64, 256, 0x1FF, 0);
+		for (int p = 0; p < producers; p++) {
+			for (int i = 0; i < cells; i++) {
+				expected (p * 64 + i / 32, i % 32) = true;
+			}
+		}
+		expect (b.hash() == expected.hash(), "edits applied while stepping");
+	}
+
+	/**
+	 * a producer and a consumer on a small ring: every value arrives once, in order
+	 **/
+	static void ring() {
+		const long count = 200000;
+		FrameRing<long> frames (4);
+		std::thread producer ([&frames] () {
+			for (long i = 0; i < count;) {
+				if (frames.push (i)) {
+					i++;
+				} else {
+					std::this_thread::yield();
+				}
+			}
+		});
+		bool ordered = true;
+		for (long next = 0; next < count;) {
+			long value;
+			if (frames.pop (value)) {
+				ordered = ordered && value == next;
+				next++;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+		producer.join();
+		long value;
+		expect (ordered && !frames.pop (value), "ring under contention");
+	}
+
+	/**
+	 * every recorded generation of a growing board is rebuilt as it was,
+	 * and a history over its budget keeps only the latest ones
+	 **/
+	static void history() {
+		std::mt19937 random (2);
+		Board b (64, 64);
+		b.blit (soup (16, 16, random).getCells(), 24, 24);
+		b.setGrowth (true);
+		History full (8), small (8, 1);
+		vector<Board> generations;
+		for (int g = 0; g < 100; g++) {
+			full.record (b);
+			small.record (b);
+			generations.push_back (b);
+			b.step();
+		}
+		bool same = full.getFirst() == 0 && full.getLast() == 99;
+		for (int g = 0; g < 100; g++) {
+			const Board at = full.at (g);
+			same = same && at.hash() == generations[g].hash() && at.getTop() == generations[g].getTop()
+			       && at.getLeft() == generations[g].getLeft();
+		}
+		expect (same, "history round trip");
+		same = small.getFirst() > 0 && small.getLast() == 99;
+		for (long g = small.getFirst(); g <= small.getLast(); g++) {
+			same = same && small.at (g).hash() == generations[g].hash();
+		}
+		try {
+			small.at (small.getFirst() - 1);
+			same = false;
+		} catch (const OutOfBounds &) {
+		}
+		expect (same, "history over its budget");
+	}
+
+	/**
+	 * a PBM sequence written by several workers holds every frame, in order
+	 **/
+	static void exporter() {
+		char path[] = "/tmp/life-check-XXXXXX";
+		const int fd = mkstemp (path);
+		if (fd < 0) {
+			failed.push_back ("exporter (no temporary file)");
+			return;
+		}
+		close (fd);
+		std::mt19937 random (3);
+		Board b = soup (70, 70, random);
+		vector<Board> generations;
+		{
+			Exporter out (path, Exporter::PBM, Exporter::SEQUENCE, 4, 2);
+			for (int g = 0; g < 30; g++) {
+				out.submit (b);
+				generations.push_back (b);
+				b.step();
+			}
+			out.finish();
+		}
+		std::ifstream in (path, std::ios::binary);
+		const string bytes ( (std::istreambuf_iterator<char> (in)), std::istreambuf_iterator<char>());
+		unlink (path);
+		const string header = "P4\n70 70\n";
+		const size_t rowBytes = 9, image = header.size() + 70 * rowBytes;
+		bool same = bytes.size() == generations.size() * image;
+		for (size_t g = 0; g < generations.size() && same; g++) {
+			same = bytes.compare (g * image, header.size(), header) == 0;
+			for (int r = 0; r < 70 && same; r++) {
+				for (int c = 0; c < 70 && same; c++) {
+					const unsigned char pixels = bytes[g * image + header.size() + r * rowBytes + c / 8];
+					same = ( (pixels >> (7 - c % 8)) & 1) == generations[g] (r, c);
+				}
+			}
+		}
+		expect (same, "exported sequence");
+	}
+
+	static bool send (const int fd, const void *data, size_t bytes) {
+		const char *p = static_cast<const char *> (data);
+		while (bytes > 0) {
+			const ssize_t n = write (fd, p, bytes);
+			if (n <= 0) {
+				return false;
+			}
+			p += n;
+			bytes -= n;
+		}
+		return true;
+	}
+
+	static bool receive (const int fd, void *data, size_t bytes) {
+		char *p = static_cast<char *> (data);
+		while (bytes > 0) {
+			const ssize_t n = read (fd, p, bytes);
+			if (n <= 0) {
+				return false;
+			}
+			p += n;
+			bytes -= n;
+		}
+		return true;
+	}
+
+	/**
+	 * a client that sends its requests and half-closes its end still gets every frame they ask for
+	 * (more than the socket buffers hold), then an end of file
+	 **/
+	static void server() {
+		Server host (2);
+		std::thread io (&Server::run, &host);
+		int ends[2];
+		if (socketpair (AF_UNIX, SOCK_STREAM, 0, ends) != 0) {
+			failed.push_back ("server (no socket pair)");
+			host.stop();
+			io.join();
+			return;
+		}
+		host.attach (ends[0]);
+		const int size = 512;
+		std::mt19937 random (4);
+		Board local = soup (size, size, random);
+		vector<int32_t> request;
+		request.push_back (Server::CREATE);
+		request.push_back (4 * sizeof (int32_t));
+		request.push_back (size);
+		request.push_back (size);
+		request.push_back (DEFAULT_SURVIVAL);
+		request.push_back (DEFAULT_BIRTH);
+		request.push_back (Server::CELLS);
+		const size_t cellsAt = request.size();
+		request.push_back (0);
+		request.push_back (Board::SET);
+		for (int r = 0; r < size; r++) {
+			for (int c = 0; c < size; c++) {
+				if (local (r, c)) {
+					request.push_back (r);
+					request.push_back (c);
+				}
+			}
+		}
+		request[cellsAt] = (request.size() - cellsAt - 1) * sizeof (int32_t);
+		request.push_back (Server::RUN);
+		request.push_back (sizeof (int64_t));
+		const int64_t generations = 10;
+		std::thread client ([&] () {
+			send (ends[1], request.data(), request.size() * sizeof (int32_t));
+			send (ends[1], &generations, sizeof (generations));
+			shutdown (ends[1], SHUT_WR);
+		});
+		Matrix<bool> cells;
+		long frames = 0, last = -1;
+		Server::FrameHeader header;
+		bool valid = true;
+		while (receive (ends[1], &header, sizeof (header))) {
+			vector<uint64_t> words (header.words);
+			valid = valid && header.magic == Server::MAGIC && receive (ends[1], words.data(), words.size() * sizeof (uint64_t));
+			if (!valid) {
+				break;
+			}
+			if (header.kind == Server::FULL) {
+				cells = Matrix<bool> (header.height, header.width);
+				for (int r = 0; r < header.height; r++) {
+					std::copy (words.begin() + size_t (r) * cells.getStride(), words.begin() + size_t (r + 1) * cells.getStride(),
+					           cells.rowWords (r));
+				}
+			} else {
+				History::decode (words.data(), words.data() + words.size(), cells);
+			}
+			frames++;
+			last = header.generation;
+		}
+		client.join();
+		close (ends[1]);
+		host.stop();
+		io.join();
+		local.step (generations);
+		// frame 0, the cells, then a frame per generation
+		expect (valid && frames == 2 + generations && last == generations && cells == local.getCells(),
+		        "frames after a half-close");
+	}
+}
+
+using namespace Check;
+
+int main() {
+	matrices();
+	blits();
+	edits();
+	ring();
+	history();
+	exporter();
+	server();
+	for (const string &check : failed) {
+		cerr << "wrong result: " << check << endl;
+	}
+	if (failed.empty()) {
+		std::cout << "all checks passed" << endl;
+	}
+	return failed.empty() ? 0 : 1;
+}
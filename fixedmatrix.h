@@ -0,0 +1,489 @@
+#ifndef _FIXEDMATRIX_H
+#define _FIXEDMATRIX_H
+
+#include <type_traits>
+#include "exceptions.h"
+#include "matrix.h"
+
+namespace Matrix {
+	/**
+	 * a compile time sequence of indices (used to unroll over the elements)
+	 **/
+	template<int... I> struct Indices {};
+
+	template<class A, class B> struct ConcatIndices;
+	template<int... I, int... J> struct ConcatIndices<Indices<I...>, Indices<J...>> {
+		typedef Indices<I..., (int (sizeof... (I)) + J)...> type;
+	};
+
+	/**
+	 * Indices<0, 1, ..., N - 1>, built in logarithmic template depth
+	 **/
+	template<int N> struct MakeIndices {
+		typedef typename ConcatIndices<typename MakeIndices<N / 2>::type, typename MakeIndices<N - N / 2>::type>::type type;
+	};
+	template<> struct MakeIndices<0> {
+		typedef Indices<> type;
+	};
+	template<> struct MakeIndices<1> {
+		typedef Indices<0> type;
+	};
+
+	template<bool...> struct BoolPack {};
+
+	/**
+	 * true if every one of A can be converted to T
+	 **/
+	template<class T, class... A> struct AllConvertible
+		: std::is_same<BoolPack<true, std::is_convertible<A, T>::value...>, BoolPack<std::is_convertible<A, T>::value..., true>> {};
+
+	/**
+	 * a rows*cols matrix whose size is known at compile time
+	 * meant for small transforms (2x2, 3x3, 4x4): the elements are stored inline,
+	 * so there's no allocation, no row pointers and no zero/one members.
+	 * element access through get() is unchecked, operator() checks the bounds
+	 * (which folds away for constant indices).
+	 * operator*, transpose, det, inverse and power are constexpr and unrolled over the elements;
+	 * det and inverse have closed forms up to 4x4 and fall back to LU on a dynamic Matrix above that
+	 * (fraction-free for integral T, so an integer det stays exact).
+	 * a FixedMatrix is a matrix expression, so it mixes with Matrix<T> in +, - and *,
+	 * a Matrix<T> can be constructed from it, and it can be constructed from a Matrix<T> of the same size.
+	 **/
+	template<class T, int R, int C> class FixedMatrix : public Expression<FixedMatrix<T, R, C>, T> {
+		static_assert (R > 0 && C > 0, "a fixed matrix can't be empty");
+
+		template<class, class, class> friend class BinaryExpression;
+		template<class, class> friend class ScalarExpression;
+		template<class> friend class NegateExpression;
+		template<class> friend class Matrix;
+		template<class, int, int> friend class FixedMatrix;
+
+		T elements[R * C];
+
+		/**
+		 * unchecked element access
+		 **/
+		constexpr const T &get (const int row, const int col) const {
+			return elements[row * C + col];
+		}
+
+		constexpr bool checkRow (const int row) const {
+			return 0 <= row && row < R;
+		}
+
+		constexpr bool checkColumn (const int col) const {
+			return 0 <= col && col < C;
+		}
+
+		/**
+		 * copies the elements of a same-sized expression
+		 **/
+		template<class E> void evaluate (const E &e) {
+			if (e.getHeight() != R || e.getWidth() != C) {
+				throw SizeMismatch();
+			}
+			for (int i = 0; i < R; i++) {
+				for (int j = 0; j < C; j++) {
+					elements[i * C + j] = e.get (i, j);
+				}
+			}
+		}
+
+		/* unrolled helpers **/
+
+		/**
+		 * row i of this times column j of b, over the first k terms
+		 **/
+		template<int N> constexpr T dot (const FixedMatrix<T, C, N> &b, const int i, const int j,
+		                                 std::integral_constant<int, 1>) const {
+			return get (i, 0) * b.get (0, j);
+		}
+
+		template<int N, int K> constexpr T dot (const FixedMatrix<T, C, N> &b, const int i, const int j,
+		                                        std::integral_constant<int, K>) const {
+			return dot (b, i, j, std::integral_constant<int, K - 1>()) + get (i, K - 1) * b.get (K - 1, j);
+		}
+
+		template<int N, int... I> constexpr FixedMatrix<T, R, N> multiply (const FixedMatrix<T, C, N> &b, Indices<I...>) const {
+			return FixedMatrix<T, R, N> (dot (b, I / N, I % N, std::integral_constant<int, C>())...);
+		}
+
+		template<class Op, int... I> constexpr FixedMatrix combine (const FixedMatrix &m, Indices<I...>) const {
+			return FixedMatrix (Op::apply (elements[I], m.elements[I])...);
+		}
+
+		template<int... I> constexpr FixedMatrix negate (Indices<I...>) const {
+			return FixedMatrix (-elements[I]...);
+		}
+
+		template<int... I> constexpr FixedMatrix scale (const T &s, Indices<I...>) const {
+			return FixedMatrix (Times::apply (elements[I], s)...);
+		}
+
+		template<int... I> constexpr FixedMatrix<T, C, R> transpose (Indices<I...>) const {
+			return FixedMatrix<T, C, R> (get (I % R, I / R)...);
+		}
+
+		template<int... I> constexpr FixedMatrix<T, R - 1, C - 1> minor (const int row, const int col, Indices<I...>) const {
+			return FixedMatrix<T, R - 1, C - 1> (get (I / (C - 1) + (I / (C - 1) >= row), I % (C - 1) + (I % (C - 1) >= col))...);
+		}
+
+		template<int... I> static constexpr FixedMatrix scalarMatrix (const T &s, Indices<I...>) {
+			return FixedMatrix ( (I / C == I % C ? s : T (0))...);
+		}
+
+		/**
+		 * the determinant of the 2x2 submatrix of rows r0, r1 and columns c0, c1
+		 **/
+		constexpr T det2 (const int r0, const int r1, const int c0, const int c1) const {
+			return get (r0, c0) * get (r1, c1) - get (r0, c1) * get (r1, c0);
+		}
+
+		constexpr T det (std::integral_constant<int, 1>) const {
+			return get (0, 0);
+		}
+
+		constexpr T det (std::integral_constant<int, 2>) const {
+			return det2 (0, 1, 0, 1);
+		}
+
+		constexpr T det (std::integral_constant<int, 3>) const {
+			return get (0, 0) * det2 (1, 2, 1, 2) - get (0, 1) * det2 (1, 2, 0, 2) + get (0, 2) * det2 (1, 2, 0, 1);
+		}
+
+		/**
+		 * Laplace expansion by the 2x2 minors of the top two rows and their complements
+		 **/
+		constexpr T det (std::integral_constant<int, 4>) const {
+			return det2 (0, 1, 0, 1) * det2 (2, 3, 2, 3) - det2 (0, 1, 0, 2) * det2 (2, 3, 1, 3)
+			       + det2 (0, 1, 0, 3) * det2 (2, 3, 1, 2) + det2 (0, 1, 1, 2) * det2 (2, 3, 0, 3)
+			       - det2 (0, 1, 1, 3) * det2 (2, 3, 0, 2) + det2 (0, 1, 2, 3) * det2 (2, 3, 0, 1);
+		}
+
+		/**
+		 * larger sizes - LU on a dynamic copy (exact for integral T)
+		 **/
+		T det (std::integral_constant<int, 0>) const {
+			return Matrix<T> (*this).det();
+		}
+
+		/**
+		 * the (row, col) cofactor
+		 **/
+		constexpr T cofactor (const int row, const int col) const {
+			return (row + col) % 2 == 0 ? minor (row, col, typename MakeIndices < (R - 1) * (C - 1) >::type()).det()
+			       : -minor (row, col, typename MakeIndices < (R - 1) * (C - 1) >::type()).det();
+		}
+
+		/**
+		 * n / d - for integral T only if it divides (an inverse that isn't integral throws, as LU's does)
+		 **/
+		static constexpr T quotient (const T &n, const T &d) {
+			return quotient (n, d, typename std::is_integral<T>::type());
+		}
+
+		static constexpr T quotient (const T &n, const T &d, std::true_type) {
+			return n % d != T (0) ? throw NonRegularMatrix() : n / d;
+		}
+
+		static constexpr T quotient (const T &n, const T &d, std::false_type) {
+			return n / d;
+		}
+
+		/**
+		 * the adjugate divided by the determinant d
+		 **/
+		template<int... I> constexpr FixedMatrix adjugate (const T &d, Indices<I...>) const {
+			return d == T (0) ? throw NonRegularMatrix() : FixedMatrix (quotient (cofactor (I % C, I / C), d)...);
+		}
+
+		constexpr FixedMatrix inverse (std::integral_constant<int, 1>) const {
+			return get (0, 0) == T (0) ? throw NonRegularMatrix() : FixedMatrix (quotient (T (1), get (0, 0)));
+		}
+
+		template<int N> constexpr FixedMatrix inverse (std::integral_constant<int, N>) const {
+			return adjugate (det(), typename MakeIndices<R * C>::type());
+		}
+
+		FixedMatrix inverse (std::integral_constant<int, 0>) const {
+			return FixedMatrix (Matrix<T> (*this).inverse());
+		}
+
+		/**
+		 * this matrix powered by exponent, by repeated squaring
+		 **/
+		constexpr FixedMatrix raise (const unsigned long exponent) const {
+			return exponent == 0 ? unitMatrix() : (exponent & 1) ? squared (raise (exponent >> 1)) * *this
+			       : squared (raise (exponent >> 1));
+		}
+
+		static constexpr FixedMatrix squared (const FixedMatrix &m) {
+			return m * m;
+		}
+
+		constexpr T trace (const int i) const {
+			return i == 0 ? get (0, 0) : trace (i - 1) + get (i, i);
+		}
+
+		// closed forms are used up to 4x4, 0 selects the LU fallback
+		typedef std::integral_constant<int, (R <= 4 ? R : 0)> SizeTag;
+	public:
+		/**
+		 * creates a zero matrix
+		 **/
+		constexpr FixedMatrix() : elements {} {}
+
+		/**
+		 * creates a matrix from its elements, row by row
+		 * @param a exactly rows*cols values
+		 **/
+		template<class... A, class = typename std::enable_if<sizeof... (A) == R * C && AllConvertible<T, A...>::value>::type>
+		constexpr FixedMatrix (const A &... a) : elements {T (a)...} {}
+
+		/**
+		 * evaluates a same-sized expression (a dynamic Matrix, or a mixed expression)
+		 * throws SizeMismatch if the sizes differ
+		 * @param e the expression
+		 **/
+		template<class E> explicit FixedMatrix (const Expression<E, T> &e) : elements {} {
+			evaluate (e.derived());
+		}
+
+		constexpr int getHeight() const {
+			return R;
+		}
+
+		constexpr int getWidth() const {
+			return C;
+		}
+
+		constexpr bool isSquare() const {
+			return R == C;
+		}
+
+		/**
+		 * returns the transposed matrix
+		 * @return the transposed matrix
+		 **/
+		constexpr FixedMatrix<T, C, R> transpose() const {
+			return transpose (typename MakeIndices<R * C>::type());
+		}
+
+		/**
+		 * gets a minor of the matrix
+		 * @param row row to remove
+		 * @param col column to remove
+		 * @return minor of the matrix
+		 **/
+		constexpr FixedMatrix<T, R - 1, C - 1> getMinor (const int row, const int col) const {
+			static_assert (R == C && R > 1, "minor of a non-square or 1x1 matrix");
+			return checkRow (row) && checkColumn (col) ? minor (row, col, typename MakeIndices < (R - 1) * (C - 1) >::type())
+			       : throw OutOfBounds();
+		}
+
+		/**
+		 * returns the determinant of the matrix
+		 * @return the determinant
+		 **/
+		constexpr T det() const {
+			static_assert (R == C, "determinant of a non-square matrix");
+			return det (SizeTag());
+		}
+
+		/**
+		 * gets the inverse of the matrix
+		 * throws NonRegularMatrix if the determinant is zero (or, for integral T, the inverse isn't integral)
+		 * @return the inverse of the matrix
+		 **/
+		constexpr FixedMatrix inverse() const {
+			static_assert (R == C, "inverse of a non-square matrix");
+			return inverse (SizeTag());
+		}
+
+		/**
+		 * returns the trace of the matrix
+		 * @return the trace
+		 **/
+		constexpr T trace() const {
+			static_assert (R == C, "trace of a non-square matrix");
+			return trace (R - 1);
+		}
+
+		/**
+		 * returns the matrix powered by r, by repeated squaring
+		 * if M is singular, throws NonRegularMatrix for r <= 0
+		 * @param r the exponent
+		 * @return M^r
+		 **/
+		constexpr FixedMatrix power (const long r) const {
+			static_assert (R == C, "power of a non-square matrix");
+			return r <= 0 ? inverse().raise (0UL - (unsigned long) r) : raise ( (unsigned long) r);
+		}
+
+		/* static functions **/
+		/**
+		 * returns the unit matrix
+		 * @return I
+		 **/
+		static constexpr FixedMatrix unitMatrix() {
+			return scalarMatrix (T (1));
+		}
+
+		/**
+		 * returns a scalar matrix
+		 * @param s the scalar
+		 * @return sI
+		 **/
+		static constexpr FixedMatrix scalarMatrix (const T &s) {
+			static_assert (R == C, "scalar matrix must be square");
+			return scalarMatrix (s, typename MakeIndices<R * C>::type());
+		}
+
+		/* operators **/
+		/**
+		 * gets the value at (i,j)
+		 * @param row row
+		 * @param col column
+		 * @return the value at (i,j)
+		 **/
+		constexpr const T &operator() (const int row, const int col) const & {
+			return checkRow (row) && checkColumn (col) ? elements[row * C + col] : throw OutOfBounds();
+		}
+		T &operator() (const int row, const int col) & {
+			if (!checkRow (row) || !checkColumn (col)) {
+				throw OutOfBounds();
+			}
+			return elements[row * C + col];
+		}
+
+		bool operator== (const FixedMatrix &m) const {
+			for (int k = 0; k < R * C; k++) {
+				if (elements[k] != m.elements[k]) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool operator!= (const FixedMatrix &m) const {
+			return ! (*this == m);
+		}
+
+		/**
+		 * expression assignment (a dynamic Matrix, or a mixed expression)
+		 * throws SizeMismatch if the sizes differ
+		 **/
+		template<class E> FixedMatrix &operator= (const Expression<E, T> &e) {
+			evaluate (e.derived());
+			return *this;
+		}
+
+		FixedMatrix &operator+= (const FixedMatrix &m) {
+			for (int k = 0; k < R * C; k++) {
+				elements[k] += m.elements[k];
+			}
+			return *this;
+		}
+
+		FixedMatrix &operator-= (const FixedMatrix &m) {
+			for (int k = 0; k < R * C; k++) {
+				elements[k] -= m.elements[k];
+			}
+			return *this;
+		}
+
+		FixedMatrix &operator*= (const T &s) {
+			for (int k = 0; k < R * C; k++) {
+				elements[k] *= s;
+			}
+			return *this;
+		}
+
+		FixedMatrix &operator*= (const FixedMatrix<T, C, C> &m) {
+			*this = *this * m;
+			return *this;
+		}
+
+		template<class U, int N, int K, int M> friend constexpr FixedMatrix<U, N, M> operator* (const FixedMatrix<U, N, K> &,
+		        const FixedMatrix<U, K, M> &);
+		template<class U, int N, int M> friend constexpr FixedMatrix<U, N, M> operator+ (const FixedMatrix<U, N, M> &,
+		        const FixedMatrix<U, N, M> &);
+		template<class U, int N, int M> friend constexpr FixedMatrix<U, N, M> operator- (const FixedMatrix<U, N, M> &,
+		        const FixedMatrix<U, N, M> &);
+		template<class U, int N, int M> friend constexpr FixedMatrix<U, N, M> operator- (const FixedMatrix<U, N, M> &);
+		template<class U, int N, int M> friend constexpr FixedMatrix<U, N, M> operator* (const FixedMatrix<U, N, M> &,
+		        const typename FixedMatrix<U, N, M>::value_type &);
+		template<class U, int N, int M> friend constexpr FixedMatrix<U, N, M> operator* (const typename FixedMatrix<U, N, M>::value_type &,
+		        const FixedMatrix<U, N, M> &);
+	};
+
+	/**
+	 * fixed matrix operands are held by reference when named, like Matrix
+	 **/
+	template<class T, int R, int C> struct Operand<FixedMatrix<T, R, C> &> {
+		typedef const FixedMatrix<T, R, C> &type;
+	};
+	template<class T, int R, int C> struct Operand<const FixedMatrix<T, R, C> &> {
+		typedef const FixedMatrix<T, R, C> &type;
+	};
+
+	/**
+	 * fixed matrix multiplication, unrolled
+	 * @param m1 matrix 1
+	 * @param m2 matrix 2
+	 * @return the multiplication of the two matrices
+	 **/
+	template<class T, int R, int K, int C> constexpr FixedMatrix<T, R, C> operator* (const FixedMatrix<T, R, K> &m1,
+	        const FixedMatrix<T, K, C> &m2) {
+		return m1.multiply (m2, typename MakeIndices<R * C>::type());
+	}
+
+	/**
+	 * fixed matrix addition
+	 * @param m1 matrix 1
+	 * @param m2 matrix 2
+	 * @return m1+m2
+	 **/
+	template<class T, int R, int C> constexpr FixedMatrix<T, R, C> operator+ (const FixedMatrix<T, R, C> &m1,
+	        const FixedMatrix<T, R, C> &m2) {
+		return m1.template combine<Plus> (m2, typename MakeIndices<R * C>::type());
+	}
+
+	/**
+	 * fixed matrix substraction
+	 * @param m1 matrix 1
+	 * @param m2 matrix 2
+	 * @return m1-m2
+	 **/
+	template<class T, int R, int C> constexpr FixedMatrix<T, R, C> operator- (const FixedMatrix<T, R, C> &m1,
+	        const FixedMatrix<T, R, C> &m2) {
+		return m1.template combine<Minus> (m2, typename MakeIndices<R * C>::type());
+	}
+
+	/**
+	 * fixed matrix negation
+	 * @param m the matrix
+	 * @return -m
+	 **/
+	template<class T, int R, int C> constexpr FixedMatrix<T, R, C> operator- (const FixedMatrix<T, R, C> &m) {
+		return m.negate (typename MakeIndices<R * C>::type());
+	}
+
+	/**
+	 * fixed matrix-scalar multiplication
+	 * @param m the matrix
+	 * @param s the scalar
+	 * @return m with each entry multiplied by s
+	 **/
+	template<class T, int R, int C> constexpr FixedMatrix<T, R, C> operator* (const FixedMatrix<T, R, C> &m,
+	        const typename FixedMatrix<T, R, C>::value_type &s) {
+		return m.scale (s, typename MakeIndices<R * C>::type());
+	}
+
+	template<class T, int R, int C> constexpr FixedMatrix<T, R, C> operator* (const typename FixedMatrix<T, R, C>::value_type &s,
+	        const FixedMatrix<T, R, C> &m) {
+		return m.scale (s, typename MakeIndices<R * C>::type());
+	}
+}
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef _GEMM_H
+#define _GEMM_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define GEMM_AVX2
+#endif
+
+namespace Matrix {
+	/**
+	 * blocking parameters of the packed matrix multiplication:
+	 * MR*NR is the register tile of the micro-kernel,
+	 * a KC*NR sliver of B stays in L1, an MC*KC block of A in L2
+	 * and a KC*NC panel of B in L3.
+	 * MC must be a multiple of MR and NC a multiple of NR.
+	 **/
+	template<class T> struct GemmBlocking {
+		enum { MR = 4, NR = 4, MC = 128, KC = 256, NC = 2048 };
+	};
+
+	template<> struct GemmBlocking<double> {
+		enum { MR = 6, NR = 8, MC = 120, KC = 256, NC = 2048 };
+	};
+
+	/**
+	 * number of threads used by large matrix multiplications
+	 * defaults to the number of hardware threads, 1 disables threading
+	 * @return a reference to the thread count
+	 **/
+	inline int &multiplyThreads() {
+		static int threads = std::max<int> (1, std::thread::hardware_concurrency());
+		return threads;
+	}
+
+	/**
+	 * cache-blocked matrix multiplication over row pointers (C += A * B).
+	 * A and B are packed into contiguous MR-row / NR-column slivers,
+	 * and an MR*NR register tile of C is computed by the micro-kernel.
+	 * large products are split into row bands, one per thread.
+	 **/
+	template<class T> class Gemm {
+		enum {
+			MR = GemmBlocking<T>::MR,
+			NR = GemmBlocking<T>::NR,
+			MC = GemmBlocking<T>::MC,
+			KC = GemmBlocking<T>::KC,
+			NC = GemmBlocking<T>::NC
+		};
+
+		// below this many multiply-adds the packing isn't worth it
+		static const long smallProduct = 32L * 32 * 32;
+		// below this many multiply-adds a single thread is used
+		static const long parallelProduct = 1L << 22;
+
+		/**
+		 * packs the mc*kc block of A at (row, col) into MR-row slivers,
+		 * zero-padding the last sliver
+		 **/
+		static void packA (const int mc, const int kc, const int row, const int col,
+		                   const T *const *a, T *packed) {
+			for (int ir = 0; ir < mc; ir += MR) {
+				for (int i = 0; i < MR; i++) {
+					T *dest = packed + i;
+					if (ir + i < mc) {
+						const T *source = a[row + ir + i] + col;
+						for (int p = 0; p < kc; p++) {
+							dest[p * MR] = source[p];
+						}
+					} else {
+						for (int p = 0; p < kc; p++) {
+							dest[p * MR] = T (0);
+						}
+					}
+				}
+				packed += MR * kc;
+			}
+		}
+
+		/**
+		 * packs the kc*nc panel of B at (row, col) into NR-column slivers,
+		 * zero-padding the last sliver
+		 **/
+		static void packB (const int kc, const int nc, const int row, const int col,
+		                   const T *const *b, T *packed) {
+			for (int jr = 0; jr < nc; jr += NR) {
+				int n = std::min<int> (NR, nc - jr);
+				for (int p = 0; p < kc; p++) {
+					const T *source = b[row + p] + col + jr;
+					int j = 0;
+					for (; j < n; j++) {
+						packed[j] = source[j];
+					}
+					for (; j < NR; j++) {
+						packed[j] = T (0);
+					}
+					packed += NR;
+				}
+			}
+		}
+
+		/**
+		 * computes the MR*NR tile ab = a * b of a packed sliver pair
+		 * @param kc the shared dimension
+		 * @param a packed MR-row sliver of A
+		 * @param b packed NR-column sliver of B
+		 * @param ab the MR*NR result (row-major)
+		 **/
+		static void kernel (const int kc, const T *a, const T *b, T *ab) {
+			portableKernel (kc, a, b, ab);
+		}
+
+		/**
+		 * the micro-kernel in plain C++ (left to the compiler to vectorize)
+		 **/
+		static void portableKernel (const int kc, const T *a, const T *b, T *ab) {
+			T acc[MR * NR];
+			std::fill (acc, acc + MR * NR, T (0));
+			for (int p = 0; p < kc; p++) {
+				for (int i = 0; i < MR; i++) {
+					const T ai = a[i];
+					for (int j = 0; j < NR; j++) {
+						acc[i * NR + j] += ai * b[j];
+					}
+				}
+				a += MR;
+				b += NR;
+			}
+			std::copy (acc, acc + MR * NR, ab);
+		}
+
+		/**
+		 * C[r0:r1, :] += A[r0:r1, :] * B
+		 **/
+		static void multiplyRows (const int r0, const int r1, const int n, const int k,
+		                          const T *const *a, const T *const *b, T **c) {
+			const int maxKc = std::min<int> (KC, k);
+			const int maxMc = std::min<int> (MC, (r1 - r0 + MR - 1) / MR * MR);
+			const int maxNc = std::min<int> (NC, (n + NR - 1) / NR * NR);
+			std::vector<T> packedA (maxMc * maxKc), packedB (maxKc * maxNc);
+			T ab[MR * NR];
+			for (int jc = 0; jc < n; jc += NC) {
+				int nc = std::min<int> (NC, n - jc);
+				for (int pc = 0; pc < k; pc += KC) {
+					int kc = std::min<int> (KC, k - pc);
+					packB (kc, nc, pc, jc, b, packedB.data());
+					for (int ic = r0; ic < r1; ic += MC) {
+						int mc = std::min<int> (MC, r1 - ic);
+						packA (mc, kc, ic, pc, a, packedA.data());
+						for (int jr = 0; jr < nc; jr += NR) {
+							int nr = std::min<int> (NR, nc - jr);
+							for (int ir = 0; ir < mc; ir += MR) {
+								int mr = std::min<int> (MR, mc - ir);
+								kernel (kc, packedA.data() + ir * kc, packedB.data() + jr * kc, ab);
+								for (int i = 0; i < mr; i++) {
+									T *row = c[ic + ir + i] + jc + jr;
+									for (int j = 0; j < nr; j++) {
+										row[j] += ab[i * NR + j];
+									}
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+
+		/**
+		 * C += A * B for small products - a plain i-k-j loop
+		 **/
+		static void multiplySmall (const int m, const int n, const int k,
+		                           const T *const *a, const T *const *b, T **c) {
+			for (int i = 0; i < m; i++) {
+				T *row = c[i];
+				for (int p = 0; p < k; p++) {
+					const T aip = a[i][p];
+					const T *source = b[p];
+					for (int j = 0; j < n; j++) {
+						row[j] += aip * source[j];
+					}
+				}
+			}
+		}
+	public:
+		/**
+		 * C += A * B
+		 * @param m rows of A and C
+		 * @param n columns of B and C
+		 * @param k columns of A and rows of B
+		 * @param a row pointers of A
+		 * @param b row pointers of B
+		 * @param c row pointers of C
+		 **/
+		static void multiply (const int m, const int n, const int k,
+		                      const T *const *a, const T *const *b, T **c) {
+			long product = long (m) * n * k;
+			if (product < smallProduct) {
+				multiplySmall (m, n, k, a, b, c);
+				return;
+			}
+			int threads = std::min<int> (multiplyThreads(), (m + MR - 1) / MR);
+			if (product < parallelProduct || threads <= 1) {
+				multiplyRows (0, m, n, k, a, b, c);
+				return;
+			}
+			// row bands in whole MR slivers
+			int band = ( (m + threads - 1) / threads + MR - 1) / MR * MR;
+			std::vector<std::thread> workers;
+			for (int r0 = band; r0 < m; r0 += band) {
+				workers.push_back (std::thread (multiplyRows, r0, std::min (r0 + band, m), n, k, a, b, c));
+			}
+			multiplyRows (0, std::min (band, m), n, k, a, b, c);
+			for (auto &w : workers) {
+				w.join();
+			}
+		}
+	};
+
+#ifdef GEMM_AVX2
+	/**
+	 * checks if the CPU runs the AVX2/FMA micro-kernel (always, when the build targets it)
+	 * @return true if it does
+	 **/
+	inline bool gemmAvx2() {
+#if defined(__AVX2__) && defined(__FMA__)
+		return true;
+#else
+		static const bool supported = (__builtin_cpu_init(), __builtin_cpu_supports ("avx2")
+		                               && __builtin_cpu_supports ("fma"));
+		return supported;
+#endif
+	}
+
+	/**
+	 * AVX2/FMA micro-kernel for double: a 6*8 tile in 12 ymm accumulators
+	 * (compiled for AVX2/FMA whatever the build flags, and only run where gemmAvx2())
+	 **/
+	__attribute__ ((target ("avx2,fma"))) inline void gemmKernelAvx2 (const int kc, const double *a, const double *b,
+	        double *ab) {
+		enum { MR = GemmBlocking<double>::MR, NR = GemmBlocking<double>::NR };
+		__m256d c[MR][2];
+		for (int i = 0; i < MR; i++) {
+			c[i][0] = _mm256_setzero_pd();
+			c[i][1] = _mm256_setzero_pd();
+		}
+		for (int p = 0; p < kc; p++) {
+			__m256d b0 = _mm256_loadu_pd (b);
+			__m256d b1 = _mm256_loadu_pd (b + 4);
+			for (int i = 0; i < MR; i++) {
+				__m256d ai = _mm256_broadcast_sd (a + i);
+				c[i][0] = _mm256_fmadd_pd (ai, b0, c[i][0]);
+				c[i][1] = _mm256_fmadd_pd (ai, b1, c[i][1]);
+			}
+			a += MR;
+			b += NR;
+		}
+		for (int i = 0; i < MR; i++) {
+			_mm256_storeu_pd (ab + i * NR, c[i][0]);
+			_mm256_storeu_pd (ab + i * NR + 4, c[i][1]);
+		}
+	}
+
+	/**
+	 * the double micro-kernel: AVX2/FMA where the CPU has it, the portable one elsewhere
+	 **/
+	template<> inline void Gemm<double>::kernel (const int kc, const double *a, const double *b, double *ab) {
+		if (gemmAvx2()) {
+			gemmKernelAvx2 (kc, a, b, ab);
+		} else {
+			portableKernel (kc, a, b, ab);
+		}
+	}
+#endif
+
+}
+
+#endif
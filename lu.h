@@ -0,0 +1,374 @@
+#ifndef _LU_H
+#define _LU_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "exceptions.h"
+
+namespace Matrix {
+	template<class T> class Matrix;
+
+	/**
+	 * LU factorization with partial pivoting: PA = LU
+	 * the factorization is done once, in place, on a single copy of the matrix
+	 * (row swaps exchange row pointers), and can then be reused for
+	 * det(), inverse(), rank() and solve() without further allocation per step.
+	 * rectangular and singular matrices are reduced to row echelon form,
+	 * a column without a usable pivot is skipped.
+	 * for a field (floating point) T pivots are chosen by magnitude,
+	 * entries within epsilon * max(height, width) * max|a| of zero are treated as zero.
+	 * integral T is eliminated without fractions (Bareiss), so det() and rank() are exact:
+	 * every entry stays a minor of the matrix, and the last pivot is the determinant.
+	 * solve() and inverse() then return adj(A) * B / det(A) - exact, or NonRegularMatrix if the result
+	 * isn't integral (e.g. the inverse of a matrix whose determinant isn't 1 or -1).
+	 **/
+	template<class T> class LU {
+		typedef typename std::is_integral<T>::type Exact;
+
+		// L (unit diagonal, below) and U (on and above) packed together,
+		// for integral T the fraction-free echelon form (nothing below the pivots)
+		Matrix<T> lu;
+		// integral T: the matrix itself, solve() eliminates it together with the right hand sides
+		Matrix<T> source;
+		// permutation[i] is the source row of row i
+		std::vector<int> permutation;
+		int swapCount;
+		int rankValue;
+
+		static T magnitude (const T &value) {
+			using std::abs;
+			return abs (value);
+		}
+
+		/**
+		 * factors lu in place
+		 **/
+		void factor() {
+			factor (Exact());
+		}
+
+		/**
+		 * fraction-free elimination: a[i][j] = (p * a[i][j] - a[i][col] * a[row][j]) / previous pivot,
+		 * where the division is exact
+		 **/
+		void factor (std::true_type) {
+			const int height = lu.getHeight();
+			const int width = lu.getWidth();
+			T **a = lu.matrix;
+			T previous = T (1);
+			int row = 0;
+			for (int col = 0; col < width && row < height; col++) {
+				int pivot = row;
+				while (pivot < height && a[pivot][col] == T (0)) {
+					pivot++;
+				}
+				if (pivot == height) {
+					continue;
+				}
+				if (pivot != row) {
+					std::swap (a[pivot], a[row]);
+					std::swap (permutation[pivot], permutation[row]);
+					swapCount++;
+				}
+				const T *u = a[row];
+				const T p = u[col];
+				for (int i = row + 1; i < height; i++) {
+					T *target = a[i];
+					const T l = target[col];
+					for (int j = col + 1; j < width; j++) {
+						target[j] = (p * target[j] - l * u[j]) / previous;
+					}
+					target[col] = T (0);
+				}
+				previous = p;
+				row++;
+			}
+			rankValue = row;
+		}
+
+		void factor (std::false_type) {
+			const int height = lu.getHeight();
+			const int width = lu.getWidth();
+			T **a = lu.matrix;
+			T largest = T (0);
+			for (int i = 0; i < height; i++) {
+				for (int j = 0; j < width; j++) {
+					if (largest < magnitude (a[i][j])) {
+						largest = magnitude (a[i][j]);
+					}
+				}
+			}
+			const T tolerance = largest * std::numeric_limits<T>::epsilon() * T (std::max (height, width));
+			int row = 0;
+			for (int col = 0; col < width && row < height; col++) {
+				int pivot = row;
+				T best = magnitude (a[row][col]);
+				for (int i = row + 1; i < height; i++) {
+					if (best < magnitude (a[i][col])) {
+						best = magnitude (a[i][col]);
+						pivot = i;
+					}
+				}
+				if (best <= tolerance) {
+					for (int i = row; i < height; i++) {
+						a[i][col] = T (0);
+					}
+					continue;
+				}
+				if (pivot != row) {
+					std::swap (a[pivot], a[row]);
+					std::swap (permutation[pivot], permutation[row]);
+					swapCount++;
+				}
+				const T *u = a[row];
+				for (int i = row + 1; i < height; i++) {
+					T *target = a[i];
+					const T l = target[col] / u[col];
+					target[col] = l;
+					if (l != T (0)) {
+						for (int j = col + 1; j < width; j++) {
+							target[j] -= l * u[j];
+						}
+					}
+				}
+				row++;
+			}
+			rankValue = row;
+		}
+
+		void keepSource (std::true_type) {
+			source = lu;
+		}
+
+		void keepSource (std::false_type) {
+		}
+
+		/**
+		 * solves AX = X in place by fraction-free Gauss-Jordan elimination of the (permuted) source:
+		 * every row ends up scaled by det(PA), which is divided out at the end
+		 * (throws NonRegularMatrix if that leaves a remainder - there is no integral solution)
+		 * @param x the right hand sides, already row-permuted, overwritten by the solutions
+		 **/
+		void substitute (Matrix<T> &x, std::true_type) const {
+			const int n = source.getHeight();
+			const int columns = x.getWidth();
+			Matrix<T> w (n);
+			for (int i = 0; i < n; i++) {
+				std::copy (source.matrix[permutation[i]], source.matrix[permutation[i]] + n, w.matrix[i]);
+			}
+			T **a = w.matrix;
+			T **b = x.matrix;
+			T previous = T (1);
+			for (int k = 0; k < n; k++) {
+				// the pivots of the factorization, so never 0
+				const T p = a[k][k];
+				for (int i = 0; i < n; i++) {
+					if (i == k) {
+						continue;
+					}
+					const T l = a[i][k];
+					for (int j = k + 1; j < n; j++) {
+						a[i][j] = (p * a[i][j] - l * a[k][j]) / previous;
+					}
+					for (int j = 0; j < columns; j++) {
+						b[i][j] = (p * b[i][j] - l * b[k][j]) / previous;
+					}
+					a[i][k] = T (0);
+				}
+				previous = p;
+			}
+			for (int i = 0; i < n; i++) {
+				for (int j = 0; j < columns; j++) {
+					if (b[i][j] % previous != T (0)) {
+						throw NonRegularMatrix();
+					}
+					b[i][j] /= previous;
+				}
+			}
+		}
+
+		/**
+		 * solves LUX = X in place, X already row-permuted
+		 * @param x the right hand sides, overwritten by the solutions
+		 **/
+		void substitute (Matrix<T> &x, std::false_type) const {
+			const int n = lu.getHeight();
+			const int columns = x.getWidth();
+			T *const *a = lu.matrix;
+			T **b = x.matrix;
+			// forward substitution (L has a unit diagonal)
+			for (int i = 1; i < n; i++) {
+				T *target = b[i];
+				for (int k = 0; k < i; k++) {
+					const T l = a[i][k];
+					if (l != T (0)) {
+						const T *source = b[k];
+						for (int j = 0; j < columns; j++) {
+							target[j] -= l * source[j];
+						}
+					}
+				}
+			}
+			// back substitution
+			for (int i = n - 1; i >= 0; i--) {
+				T *target = b[i];
+				for (int k = i + 1; k < n; k++) {
+					const T u = a[i][k];
+					if (u != T (0)) {
+						const T *source = b[k];
+						for (int j = 0; j < columns; j++) {
+							target[j] -= u * source[j];
+						}
+					}
+				}
+				const T inverse = T (1) / a[i][i];
+				for (int j = 0; j < columns; j++) {
+					target[j] *= inverse;
+				}
+			}
+		}
+
+		/**
+		 * throws unless the factored matrix is square and regular
+		 **/
+		void checkRegular() const {
+			if (!lu.isSquare()) {
+				throw NonSquareMatrix();
+			}
+			if (!isRegular()) {
+				throw NonRegularMatrix();
+			}
+		}
+	public:
+		/**
+		 * factors the given matrix
+		 * @param m the matrix to factor (copied once)
+		 **/
+		explicit LU (const Matrix<T> &m) : lu (m), permutation (m.getHeight()), swapCount (0), rankValue (0) {
+			for (int i = 0; i < m.getHeight(); i++) {
+				permutation[i] = i;
+			}
+			keepSource (Exact());
+			factor();
+		}
+
+		/**
+		 * factors the given matrix in its own storage
+		 * @param m the matrix to factor (moved from)
+		 **/
+		explicit LU (Matrix<T> &&m) : lu (std::move (m)), permutation (lu.getHeight()), swapCount (0), rankValue (0) {
+			for (int i = 0; i < lu.getHeight(); i++) {
+				permutation[i] = i;
+			}
+			keepSource (Exact());
+			factor();
+		}
+
+		/**
+		 * returns the rank of the factored matrix
+		 * @return the rank
+		 **/
+		int rank() const {
+			return rankValue;
+		}
+
+		/**
+		 * checks if the factored matrix is square and invertible
+		 * @return true if regular
+		 **/
+		bool isRegular() const {
+			return lu.isSquare() && rankValue == lu.getHeight();
+		}
+
+		/**
+		 * returns the determinant of the factored matrix
+		 * @return the determinant
+		 **/
+		T det() const {
+			if (!lu.isSquare()) {
+				throw NonSquareMatrix();
+			}
+			if (!isRegular()) {
+				return T (0);
+			}
+			if (lu.getHeight() == 0) {
+				// the empty product
+				return T (1);
+			}
+			return det (Exact());
+		}
+
+		T det (std::true_type) const {
+			const int n = lu.getHeight();
+			return swapCount % 2 == 1 ? -lu.matrix[n - 1][n - 1] : lu.matrix[n - 1][n - 1];
+		}
+
+		T det (std::false_type) const {
+			T product = T (1);
+			for (int i = 0; i < lu.getHeight(); i++) {
+				product *= lu.matrix[i][i];
+			}
+			if (swapCount % 2 == 1) {
+				product = -product;
+			}
+			return product;
+		}
+
+		/**
+		 * solves AX = B for all the columns of B at once
+		 * throws NonRegularMatrix if A is singular (or, for integral T, X isn't integral)
+		 * @param b the right hand sides (height must match A)
+		 * @return X
+		 **/
+		Matrix<T> solve (const Matrix<T> &b) const {
+			checkRegular();
+			if (b.getHeight() != lu.getHeight()) {
+				throw SizeMismatch();
+			}
+			Matrix<T> x (b.getHeight(), b.getWidth());
+			for (int i = 0; i < x.getHeight(); i++) {
+				std::copy (b.matrix[permutation[i]], b.matrix[permutation[i]] + b.getWidth(), x.matrix[i]);
+			}
+			substitute (x, Exact());
+			return x;
+		}
+
+		/**
+		 * returns the inverse of the factored matrix
+		 * throws NonRegularMatrix if singular (or, for integral T, the inverse isn't integral)
+		 * @return the inverse
+		 **/
+		Matrix<T> inverse() const {
+			checkRegular();
+			Matrix<T> x (lu.getHeight());
+			for (int i = 0; i < x.getHeight(); i++) {
+				x.matrix[i][permutation[i]] = T (1);
+			}
+			substitute (x, Exact());
+			return x;
+		}
+
+		/**
+		 * returns the packed factors (L below the diagonal, U on and above)
+		 * @return the packed factors, with rows in pivot order
+		 **/
+		const Matrix<T> &factors() const {
+			return lu;
+		}
+
+		/**
+		 * returns the row permutation
+		 * @return the source row of each row of the factors
+		 **/
+		const std::vector<int> &getPermutation() const {
+			return permutation;
+		}
+	};
+}
+
+#endif
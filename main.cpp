@@ -1,34 +1,57 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <exception>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <system_error>
 #include <utility>
-#include <list>
+#include <vector>
 #include "Board.h"
+#include "Pattern.h"
+#include "Pipeline.h"
+#include "TileScheduler.h"
 using Life::Board;
+using Life::Pattern;
+using Life::Pipeline;
+using Life::TileScheduler;
+using std::cerr;
 using std::cout;
 using std::endl;
 using std::pair;
-using std::list;
+using std::string;
+using std::vector;
 
-int main (int argc, char **argv) {
+// largest board (height * width) accepted - the event engine indexes the cells with an int
+static const long long MAX_CELLS = INT_MAX;
+
+// the Gosper glider gun, the pattern of the demo and of runs without a pattern file
+static const vector<pair<int, int>> gosper = {
+	{5 , 1}, {5, 2}, {6, 1}, {6, 2}
+	, {3, 36}, {4, 36}, {3, 35}, {4, 35}
+	, {5, 11}, {6, 11}, {7, 11}, {4, 12}, {8, 12}, {3, 13}, {3, 14}, {9, 13}, {9, 14}
+	, {6, 15}, {4, 16}, {8, 16}, {5, 17}, {6, 17}, {7, 17}, {6, 18}
+	, {3, 21}, {4, 21}, {5, 21}, {3, 22}, {4, 22}, {5, 22}, {2, 23}, {6, 23}
+	, {1, 25}, {2, 25}, {6, 25}, {7, 25}
+};
+
+/**
+ * the demo run without arguments: the gun, its copy and a reset
+ **/
+static int demo() {
 	constexpr int height = 23;
 	constexpr int width = 38;
 	Board b (height, width);
 	cout << b << endl;
 
-	list<pair<int, int>> pattern = {
-		{5 , 1}, {5, 2}, {6, 1}, {6, 2}
-		, {3, 36}, {4, 36}, {3, 35}, {4, 35}
-		, {5, 11}, {6, 11}, {7, 11}, {4, 12}, {8, 12}, {3, 13}, {3, 14}, {9, 13}, {9, 14}
-		, {6, 15}, {4, 16}, {8, 16}, {5, 17}, {6, 17}, {7, 17}, {6, 18}
-		, {3, 21}, {4, 21}, {5, 21}, {3, 22}, {4, 22}, {5, 22}, {2, 23}, {6, 23}
-		, {1, 25}, {2, 25}, {6, 25}, {7, 25}
-	};
-	b.updateList (pattern);
+	b.update (gosper);
 
-	for (int i = 0; i < 100; i++) {
-		cout << b << endl;
-		b.step();
-	}
-	cout << b << endl;
+	// simulate and print concurrently
+	Pipeline (cout).run (b, 100);
 
 	cout << b.getHeight() << endl;
 	cout << b.getWidth() << endl;
@@ -43,3 +66,184 @@ int main (int argc, char **argv) {
 	cout << b.reset() << endl;
 	return 0;
 }
+
+static int usage() {
+	cerr << "usage: gameoflife [-s HxW] [-r rule] [-p pattern] [-g generations] [-j threads]" << endl
+	     << "                  [-e tiled|events] [-l rows|morton] [-c cadence | -q]" << endl
+	     << "  -s  board size, HxW or a side (default: 23x38, or three times the pattern)" << endl
+	     << "  -r  rule in B/S or S/B notation, e.g. B3/S23 or 23/3 (default: the pattern's, or B3/S23)" << endl
+	     << "  -p  pattern file (RLE, Life 1.06 or plaintext), centered (default: a Gosper gun)" << endl
+	     << "  -g  generations (default 100)" << endl
+	     << "  -j  threads stepping the board (default: one per hardware thread)" << endl
+	     << "  -e  engine, -l  cell layout of the tiled engine (see Board)" << endl
+	     << "  -c  print every n-th generation (default 1)" << endl
+	     << "  -q  headless: print no frames, only the final timing and statistics" << endl;
+	return 2;
+}
+
+/**
+ * reads a board size, HxW or a single side
+ * @return false if malformed, or larger than MAX_CELLS
+ **/
+static bool parseSize (const string &size, int &height, int &width) {
+	char *end;
+	errno = 0;
+	const long h = strtol (size.c_str(), &end, 10);
+	long w = h;
+	if (*end == 'x' || *end == 'X') {
+		w = strtol (end + 1, &end, 10);
+	}
+	if (*end != '\0' || errno == ERANGE || h <= 0 || w <= 0 || h > INT_MAX || w > INT_MAX
+	        || (long long) h * w > MAX_CELLS) {
+		return false;
+	}
+	height = h;
+	width = w;
+	return true;
+}
+
+/**
+ * reads a positive (or, if allowed, zero) count
+ * @return false if malformed
+ **/
+static bool parseCount (const string &value, long &count, const bool zero) {
+	char *end;
+	count = strtol (value.c_str(), &end, 10);
+	return *end == '\0' && !value.empty() && (count > 0 || (zero && count == 0));
+}
+
+/**
+ * the batch run: parses the options, then runs the pattern
+ **/
+static int batch (int argc, char **argv) {
+	int height = 0, width = 0;
+	string rule, patternFile;
+	long generations = 100, threads = 0, cadence = 1;
+	bool headless = false;
+	Board::Engine engine = Board::TILED;
+	Board::Layout layout = Board::ROW_MAJOR;
+	for (int i = 1; i < argc; i++) {
+		const string option = argv[i];
+		if (option == "-q" || option == "--headless") {
+			headless = true;
+			continue;
+		}
+		if (option == "-h" || option == "--help" || i + 1 == argc) {
+			return usage();
+		}
+		const string value = argv[++i];
+		bool valid = true;
+		if (option == "-s") {
+			valid = parseSize (value, height, width);
+		} else if (option == "-r") {
+			rule = value;
+		} else if (option == "-p") {
+			patternFile = value;
+		} else if (option == "-g") {
+			valid = parseCount (value, generations, true);
+		} else if (option == "-j") {
+			valid = parseCount (value, threads, false);
+		} else if (option == "-c") {
+			valid = parseCount (value, cadence, false);
+		} else if (option == "-e" && (value == "tiled" || value == "events")) {
+			engine = value == "tiled" ? Board::TILED : Board::EVENTS;
+		} else if (option == "-l" && (value == "rows" || value == "morton")) {
+			layout = value == "rows" ? Board::ROW_MAJOR : Board::MORTON;
+		} else {
+			return usage();
+		}
+		if (!valid) {
+			cerr << "invalid value for " << option << ": " << value << endl;
+			return 2;
+		}
+	}
+
+	Pattern pattern;
+	vector<pair<int, int>> cells = gosper;
+	int patternHeight = 23, patternWidth = 38;
+	if (!patternFile.empty()) {
+		try {
+			pattern = Pattern::load (patternFile);
+		} catch (const std::system_error &e) {
+			cerr << e.what() << endl;
+			return 1;
+		} catch (const std::exception &e) {
+			cerr << patternFile << ": " << e.what() << endl;
+			return 1;
+		}
+		cells = pattern.getCells();
+		patternHeight = pattern.getHeight();
+		patternWidth = pattern.getWidth();
+		if (height == 0) {
+			// (a header may claim any size - the board size is checked below)
+			height = std::min<long long> (std::max (1LL, 3LL * patternHeight), INT_MAX);
+			width = std::min<long long> (std::max (1LL, 3LL * patternWidth), INT_MAX);
+		}
+		if (rule.empty()) {
+			rule = pattern.getRule();
+		}
+	} else if (height == 0) {
+		height = patternHeight;
+		width = patternWidth;
+	}
+	if ( (long long) height * width > MAX_CELLS) {
+		cerr << "the board (" << height << "x" << width << ") is larger than " << MAX_CELLS << " cells" << endl;
+		return 1;
+	}
+	if (patternHeight > height || patternWidth > width) {
+		cerr << "the pattern (" << patternHeight << "x" << patternWidth << ") doesn't fit the board" << endl;
+		return 1;
+	}
+	unsigned int survival = DEFAULT_SURVIVAL, birth = DEFAULT_BIRTH;
+	if (!rule.empty() && !Board::parseRule (rule, survival, birth)) {
+		cerr << "invalid rule " << rule << endl;
+		return 2;
+	}
+
+	// declared before the board, which steps on it
+	std::unique_ptr<TileScheduler> scheduler;
+	if (threads > 0) {
+		scheduler.reset (new TileScheduler (threads));
+	}
+	Board b (height, width, survival, birth);
+	b.setScheduler (scheduler.get()).setEngine (engine).setLayout (layout);
+	const int top = (height - patternHeight) / 2, left = (width - patternWidth) / 2;
+	for (auto &cell : cells) {
+		cell.first += top;
+		cell.second += left;
+	}
+	b.update (cells);
+
+	auto start = std::chrono::steady_clock::now();
+	if (headless) {
+		b.step (generations);
+	} else {
+		Pipeline (cout).setCadence (cadence).run (b, generations);
+	}
+	const double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+	const double updates = double (height) * width * generations;
+
+	cout << "board " << height << "x" << width << ' ' << b.getRule() << ", "
+	     << (engine == Board::TILED ? layout == Board::MORTON ? "tiled (morton)" : "tiled" : "events") << ", "
+	     << (scheduler ? scheduler->getThreads() : TileScheduler::shared().getThreads()) << " thread(s)" << endl;
+	cout << "generations " << generations << " in " << seconds << " s";
+	if (seconds > 0) {
+		cout << " (" << generations / seconds << " generations/s, " << updates / seconds / 1e6
+		     << " M cell updates/s)";
+	}
+	cout << endl;
+	cout << "population " << b.population() << ", hash " << std::hex << b.hash() << std::dec << endl;
+	return 0;
+}
+
+int main (int argc, char **argv) {
+	if (argc == 1) {
+		return demo();
+	}
+	try {
+		return batch (argc, argv);
+	} catch (const std::bad_alloc &) {
+		cerr << "out of memory" << endl;
+		return 1;
+	}
+}
@@ -4,8 +4,17 @@
 #include <iostream>
 #include <algorithm>
 #include <limits>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include <assert.h>
 #include "exceptions.h"
+#include "arena.h"
+#include "gemm.h"
+#include "lu.h"
+#include "bitmatrix.h"
 using std::ostream;
 using std::endl;
 using std::numeric_limits;
@@ -15,6 +24,39 @@ using std::cerr;
 #endif
 
 namespace Matrix {
+	template<class T> class Matrix;
+	template<class T, int R, int C> class FixedMatrix;
+	template<class T> class MatrixView;
+	template<class T> class SparseMatrix;
+
+	/**
+	 * tag base of every matrix expression (used for overload selection)
+	 **/
+	class ExpressionBase {};
+
+	/**
+	 * lazily evaluated matrix expression (CRTP base)
+	 * E must provide getHeight(), getWidth() and an unchecked get(i, j).
+	 * expressions are evaluated in a single pass when assigned to a Matrix,
+	 * so a + b * 2 - c allocates only the result.
+	 **/
+	template<class E, class T> class Expression : public ExpressionBase {
+	public:
+		typedef T value_type;
+
+		const E &derived() const {
+			return static_cast<const E &> (*this);
+		}
+
+		/**
+		 * evaluates the expression into a new matrix
+		 * @return the evaluated matrix
+		 **/
+		Matrix<T> eval() const {
+			return Matrix<T> (*this);
+		}
+	};
+
 	/**
 	 * requirements from T:
 	 * T(0), T(1) (assign add itentity & multiply identity)
@@ -26,13 +68,97 @@ namespace Matrix {
 	 * - (negation)
 	 * * (multiply)
 	 **/
-	template<class T> class Matrix {
+	template<class T> class Matrix : public Expression<Matrix<T>, T> {
+		template<class, class, class> friend class BinaryExpression;
+		template<class, class> friend class ScalarExpression;
+		template<class> friend class NegateExpression;
+		template<class, int, int> friend class FixedMatrix;
+		template<class> friend class MatrixView;
+		template<class> friend class SparseMatrix;
+		template<class U> friend Matrix<U> operator* (const Matrix<U> &, const Matrix<U> &);
+		friend class LU<T>;
+
 		// zero and one constants (for a little bit of efficiency)
 		T const zero = T (0);
 		T const one = T (1);
 
+		// row pointers, kept in the same block as the elements
 		T **matrix;
 		int height, width;
+		// start of the storage block (rows may have been swapped since)
+		T *elements;
+		// where the storage comes from - fixed for the lifetime of the matrix
+		MemoryResource *resource;
+
+		/**
+		 * unchecked element access, used by expression evaluation
+		 **/
+		const T &get (const int row, const int col) const {
+			return matrix[row][col];
+		}
+
+		/**
+		 * takes over the storage of m, leaving it withered (0*0)
+		 * @param m the matrix to steal from
+		 **/
+		void steal (Matrix &m) {
+			if (resource != m.resource) {
+				// storage of another resource can't be adopted - copy it
+				if (height != m.height || width != m.width) {
+					resize (m.height, m.width);
+				}
+				for (int i = 0; i < height; i++) {
+					std::copy (m.matrix[i], m.matrix[i] + width, matrix[i]);
+				}
+				m.resize (0, 0);
+				return;
+			}
+			resize (0, 0);
+			matrix = m.matrix;
+			elements = m.elements;
+			height = m.height;
+			width = m.width;
+			m.matrix = nullptr;
+			m.elements = nullptr;
+			m.height = 0;
+			m.width = 0;
+		}
+
+		/**
+		 * exchanges the storage (and its resource) of two matrices
+		 **/
+		void swapStorage (Matrix &m) {
+			std::swap (matrix, m.matrix);
+			std::swap (elements, m.elements);
+			std::swap (height, m.height);
+			std::swap (width, m.width);
+			std::swap (resource, m.resource);
+		}
+
+		/**
+		 * sets target = a * b, target already sized (the product of power())
+		 **/
+		static void multiplyInto (const Matrix &a, const Matrix &b, Matrix &target) {
+			for (int i = 0; i < target.height; i++) {
+				std::fill (target.matrix[i], target.matrix[i] + target.width, T (0));
+			}
+			Gemm<T>::multiply (a.height, b.width, a.width, a.matrix, b.matrix, target.matrix);
+		}
+
+		/**
+		 * evaluates an expression of the same size into this matrix in one pass.
+		 * elementwise expressions only read (i,j) to write (i,j),
+		 * so this matrix may safely appear inside e.
+		 * @param e the expression
+		 **/
+		template<class E> void evaluate (const E &e) {
+			for (int i = 0; i < height; i++) {
+				T *row = matrix[i];
+				for (int j = 0; j < width; j++) {
+					row[j] = e.get (i, j);
+				}
+			}
+		}
 
 		bool checkRow (const int row) const {
 			return (0 <= row && row < height);
@@ -80,8 +206,21 @@ namespace Matrix {
 			}
 		}
 
+		/**
+		 * returns the bytes of the elements of an h*w matrix, padded for the row pointers that follow
+		 **/
+		static size_t elementBytes (const int h, const int w) {
+			const size_t bytes = size_t (h) * w * sizeof (T);
+			return (bytes + alignof (T *) - 1) / alignof (T *) * alignof (T *);
+		}
+
+		static size_t storageAlignment() {
+			return std::max (alignof (T), alignof (T *));
+		}
+
 		/**
 		 * resizes the matrix to a new size (removes the old one)
+		 * the elements and the row pointers are a single allocation from the resource.
 		 * if the new size is 0x0, just deallocates everything
 		 * @param newHeight the new height
 		 * @param newWidth the new width
@@ -95,18 +234,26 @@ namespace Matrix {
 				throw InvalidSize();
 			}
 			if (getWidth() != 0 || getHeight() != 0) {
-				for (int i = 0; i < getHeight(); i++) {
-					delete[] matrix[i];
+				const size_t count = size_t (height) * width;
+				for (size_t k = 0; k < count; k++) {
+					elements[k].~T();
 				}
-				delete[] matrix;
+				resource->deallocate (elements, elementBytes (height, width) + height * sizeof (T *), storageAlignment());
+				matrix = nullptr;
+				elements = nullptr;
 				width = 0;
 				height = 0;
 			}
 			if (newHeight != 0 && newWidth != 0) {
-				matrix = new T*[newHeight];
+				const size_t bytes = elementBytes (newHeight, newWidth);
+				char *storage = static_cast<char *> (resource->allocate (bytes + newHeight * sizeof (T *),
+				                                     storageAlignment()));
+				elements = reinterpret_cast<T *> (storage);
+				matrix = reinterpret_cast<T **> (storage + bytes);
 				for (int i = 0; i < newHeight; i++) {
-					matrix[i] = new T[newWidth];
+					matrix[i] = elements + size_t (i) * newWidth;
 					for (int j = 0; j < newWidth; j++) {
+						new (matrix[i] + j) T();
 						matrix[i][j] = 0;
 					}
 				}
@@ -115,6 +262,62 @@ namespace Matrix {
 			}
 		}
 
+		/**
+		 * swaps two rows in place (exchanges the row pointers)
+		 **/
+		void swapRows (const int r1, const int r2) {
+			std::swap (matrix[r1], matrix[r2]);
+		}
+
+		/**
+		 * swaps two columns in place
+		 **/
+		void swapColumns (const int c1, const int c2) {
+			for (int i = 0; i < height; i++) {
+				std::swap (matrix[i][c1], matrix[i][c2]);
+			}
+		}
+
+		/**
+		 * adds a multiplication of row source to row destination in place
+		 * (values that become equal to zero are snapped to zero)
+		 **/
+		void addRowMultiple (const int destination, const int source, const T &s) {
+			T *target = matrix[destination];
+			const T *row = matrix[source];
+			bool zeroScalar = isEqual (s, zero);
+			for (int i = 0; i < width; i++) {
+				if (!zeroScalar && !isEqual (row[i], zero)) {
+					target[i] += row[i] * s;
+				}
+				if (isEqual (target[i], zero)) {
+					target[i] = zero;
+				}
+			}
+		}
+
+		// the side of the square tiles of transpose, and the size from which it may use threads
+		enum { TransposeTile = 32 };
+		static const long parallelTranspose = 1L << 18;
+
+		/**
+		 * writes the transpose of rows [r0, r1) into columns [r0, r1) of target, a tile at a time
+		 **/
+		void transposeRows (const int r0, const int r1, T **target) const {
+			for (int ib = r0; ib < r1; ib += TransposeTile) {
+				const int ie = std::min<int> (ib + TransposeTile, r1);
+				for (int jb = 0; jb < width; jb += TransposeTile) {
+					const int je = std::min<int> (jb + TransposeTile, width);
+					for (int i = ib; i < ie; i++) {
+						const T *source = matrix[i];
+						for (int j = jb; j < je; j++) {
+							target[j][i] = source[j];
+						}
+					}
+				}
+			}
+		}
+
 		static bool isEqual (const T &value1, const T &value2) {
 			auto difference = abs (value1 - value2);
 			auto epsilon = numeric_limits<decltype (difference) >::epsilon();
@@ -126,7 +329,18 @@ namespace Matrix {
 		 * @param height
 		 * @param width
 		 **/
-		Matrix (const int height, const int width) : height (0), width (0) {
+		Matrix (const int height, const int width) : Matrix (height, width, currentResource()) {
+		}
+
+		/**
+		 * creates a new h*w matrix in the given resource
+		 * (by default matrices use the resource current on the creating thread, see ScopedArena)
+		 * @param height
+		 * @param width
+		 * @param resource where the storage comes from
+		 **/
+		Matrix (const int height, const int width, MemoryResource *resource) : matrix (nullptr), height (0),
+			width (0), elements (nullptr), resource (resource) {
 			resize (height, width);
 		}
 
@@ -144,6 +358,22 @@ namespace Matrix {
 			assign (m);
 		}
 
+		/**
+		 * move constructor - takes over the storage (and the resource) of m
+		 * @param m the matrix to move from (left withered)
+		 **/
+		Matrix (Matrix<T> &&m) : matrix (nullptr), height (0), width (0), elements (nullptr), resource (m.resource) {
+			steal (m);
+		}
+
+		/**
+		 * evaluates an expression into a new matrix
+		 * @param e the expression
+		 **/
+		template<class E> Matrix (const Expression<E, T> &e) : Matrix (e.derived().getHeight(), e.derived().getWidth()) {
+			evaluate (e.derived());
+		}
+
 		/**
 		 * default c-tor - creates a withered (0*0) matrix
 		 **/
@@ -163,14 +393,27 @@ namespace Matrix {
 
 		/**
 		 * returns a transposed copy of the given matrix
+		 * the copy goes tile by tile, so both the rows read and the rows written stay in cache.
+		 * large matrices may be split into bands of rows, one per thread.
+		 * @param threads the most threads to use (1 - the calling thread only)
 		 * @return a transposed version of the current matrix
 		 **/
-		Matrix transpose() const {
+		Matrix transpose (const int threads = 1) const {
 			Matrix<T> ret (width, height);
-			for (int i = 0; i < height; i++) {
-				for (int j = 0; j < width; j++) {
-					ret (j, i) = at (i, j);
-				}
+			int bands = std::min<int> (threads, (height + TransposeTile - 1) / TransposeTile);
+			if (long (height) * width < parallelTranspose || bands <= 1) {
+				transposeRows (0, height, ret.matrix);
+				return ret;
+			}
+			// row bands in whole tiles
+			int band = ( (height + bands - 1) / bands + TransposeTile - 1) / TransposeTile * TransposeTile;
+			std::vector<std::thread> workers;
+			for (int r0 = band; r0 < height; r0 += band) {
+				workers.push_back (std::thread (&Matrix::transposeRows, this, r0, std::min (r0 + band, height), ret.matrix));
+			}
+			transposeRows (0, std::min (band, height), ret.matrix);
+			for (auto &w : workers) {
+				w.join();
 			}
 			return ret;
 		}
@@ -186,7 +429,7 @@ namespace Matrix {
 			}
 			Matrix<T> ret (width, 1);
 			for (int i = 0; i < width; i++) {
-				ret (i, 0) = this->at (row, i);
+				ret.matrix[i][0] = matrix[row][i];
 			}
 			return ret;
 		}
@@ -197,14 +440,66 @@ namespace Matrix {
 		 * @return the column vector
 		 **/
 		Matrix getColumn (const int col) const {
-			if (!checkColumn (col)) {
+			return Matrix<T> (columnView (col));
+		}
+
+		/**
+		 * a 1*width view of a row, without copying
+		 * @param row the row
+		 * @return the view
+		 **/
+		MatrixView<T> rowView (const int row) const {
+			return submatrix (row, 0, 1, width);
+		}
+
+		/**
+		 * a height*1 view of a column, without copying
+		 * @param col the column
+		 * @return the view
+		 **/
+		MatrixView<T> columnView (const int col) const {
+			return submatrix (0, col, height, 1);
+		}
+
+		/**
+		 * a view of a submatrix, without copying
+		 * @param top the first row
+		 * @param left the first column
+		 * @param rows the number of rows of the view
+		 * @param cols the number of columns of the view
+		 * @param rowStep the distance between consecutive rows of the view
+		 * @param colStep the distance between consecutive columns of the view
+		 * @return the view
+		 **/
+		MatrixView<T> submatrix (const int top, const int left, const int rows, const int cols,
+		                         const int rowStep = 1, const int colStep = 1) const {
+			if (rows <= 0 || cols <= 0 || rowStep <= 0 || colStep <= 0) {
+				throw InvalidSize();
+			}
+			if (!checkRow (top) || !checkColumn (left) || !checkRow (top + long (rows - 1) * rowStep)
+			        || !checkColumn (left + long (cols - 1) * colStep)) {
 				throw OutOfBounds();
 			}
-			Matrix<T> ret (height, 1);
-			for (int i = 0; i < height; i++) {
-				ret (i, 0) = this->at (i, col);
+			return MatrixView<T> (matrix, top, left, rows, cols, rowStep, colStep, rows, cols);
+		}
+
+		/**
+		 * a view of a minor of the matrix, without copying
+		 * @param row row to remove
+		 * @param col column to remove
+		 * @return the view
+		 **/
+		MatrixView<T> minorView (const int row, const int col) const {
+			if (!isSquare()) {
+				throw NonSquareMatrix();
 			}
-			return ret;
+			if (!checkColumn (col) || !checkRow (row)) {
+				throw OutOfBounds();
+			}
+			if (height == 1) {
+				throw InvalidSize();
+			}
+			return MatrixView<T> (matrix, 0, 0, height - 1, width - 1, 1, 1, row, col);
 		}
 
 		/**
@@ -222,30 +517,7 @@ namespace Matrix {
 		 * @return minor of the matrix
 		 **/
 		Matrix getMinor (const int row, const int col) const {
-			if (!isSquare()) {
-				throw NonSquareMatrix();
-			}
-			if (!checkColumn (col) || !checkRow (row)) {
-				throw OutOfBounds();
-			}
-			Matrix<T> ret (height - 1, width - 1);
-			int targetI, targetJ;
-			targetI = targetJ = 0;
-			for (int i = 0; i < height; i++) {
-				if (i == row) {
-					continue;
-				}
-				targetJ = 0;
-				for (int j = 0; j < width; j++) {
-					if (j == col) {
-						continue;
-					}
-					ret (targetI, targetJ) = at (i, j);
-					targetJ++;
-				}
-				targetI++;
-			}
-			return ret;
+			return Matrix<T> (minorView (row, col));
 		}
 
 		/**
@@ -256,20 +528,7 @@ namespace Matrix {
 			if (!isSquare()) {
 				throw NonSquareMatrix();
 			}
-			int swapCount = 0;
-			Matrix<T> dummy;
-			Matrix<T> triangular = gaussianElimination (swapCount, dummy);
-			T product = one;
-			for (int i = 0; i < width; i++) {
-				product *= triangular (i, i);
-				if (isEqual (product, zero)) {
-					break;
-				}
-			}
-			if (swapCount % 2 == 1) {
-				product = -product;
-			}
-			return product;
+			return lu().det();
 		}
 
 		/**
@@ -280,12 +539,16 @@ namespace Matrix {
 			if (!isSquare()) {
 				throw NonSquareMatrix();
 			}
-			Matrix<T> ret;
-			gaussianElimination (ret, true);
-			if (ret.width == 0) {
-				throw NonRegularMatrix();
-			}
-			return ret;
+			return lu().inverse();
+		}
+
+		/**
+		 * returns the LU factorization of the matrix,
+		 * to be reused for several det/inverse/rank/solve queries
+		 * @return the factorization
+		 **/
+		LU<T> lu() const {
+			return LU<T> (*this);
 		}
 
 		/**
@@ -314,11 +577,7 @@ namespace Matrix {
 				throw OutOfBounds();
 			}
 			Matrix<T> ret = *this;
-			if (r1 != r2) {
-				for (int i = 0; i < ret.width; i++) {
-					std::swap (ret (r1, i), ret (r2, i));
-				}
-			}
+			ret.swapRows (r1, r2);
 			return ret;
 		}
 
@@ -344,14 +603,7 @@ namespace Matrix {
 				throw OutOfBounds();
 			}
 			Matrix<T> ret = *this;
-			for (int i = 0; i < ret.width; i++) {
-				if (!isEqual (ret (source, i), zero) && !isEqual (s, zero)) {
-					ret (destination, i) += ret (source, i) * s;
-				}
-				if (isEqual (ret (destination, i), zero)) {
-					ret (destination, i) = zero;
-				}
-			}
+			ret.addRowMultiple (destination, source, s);
 			return ret;
 		}
 
@@ -383,39 +635,46 @@ namespace Matrix {
 		 * @return the matrix with the two columns swapped
 		 **/
 		Matrix colSwap (int c1, int c2) const {
-			return transpose().rowSwap (c1, c2).transpose();
+			if (!checkColumn (c1) || !checkColumn (c2)) {
+				throw OutOfBounds();
+			}
+			Matrix<T> ret = *this;
+			ret.swapColumns (c1, c2);
+			return ret;
 		}
 
 		/**
-		 * returns the matrix powered by r
+		 * returns the matrix powered by r, by repeated squaring
 		 * works only for square matrices, throws NonSquareMatrix otherwise
 		 * if M is singular, throws NonRegularMatrix for r <= 0
 		 * @param r the exponent
 		 * @return M^r
 		 **/
-		Matrix power (int r) const {
+		Matrix power (const long r) const {
 			if (!isSquare()) {
 				throw NonSquareMatrix();
 			}
-			if (r <= 0 && rank() < width) {
-				throw NonRegularMatrix();
-			}
-			Matrix<T> multiplier;
-			Matrix<T> ret = unitMatrix (width);
-			if (r <= 0) {
-				multiplier = inverse(); // will throw NonRegularMatrix on failure
-				r = -r;
-			} else {
-				multiplier = *this;
+			Matrix<T> multiplier = r <= 0 ? inverse() : *this; // will throw NonRegularMatrix on failure
+			unsigned long exponent = r < 0 ? 0UL - (unsigned long) r : (unsigned long) r;
+			Matrix<T> product = unitMatrix (width);
+			if (width == 0) {
+				return product;
 			}
-			while (r > 0) {
-				if (ret == zero) {
-					break;
+			// every square and partial product is written to the spare buffer, which then swaps places
+			// with its operand - three buffers whatever the exponent
+			Matrix<T> spare (width);
+			while (exponent > 0) {
+				if (exponent & 1) {
+					multiplyInto (product, multiplier, spare);
+					product.swapStorage (spare);
+				}
+				exponent >>= 1;
+				if (exponent > 0) {
+					multiplyInto (multiplier, multiplier, spare);
+					multiplier.swapStorage (spare);
 				}
-				ret *= multiplier;
-				r--;
 			}
-			return ret;
+			return product;
 		}
 
 		/**
@@ -464,9 +723,9 @@ namespace Matrix {
 				if (isEqual (a, zero)) {
 					for (j = i + 1; j < ret.height; j++) {
 						if (!isEqual (ret (j, i), zero)) {
-							ret = ret.rowSwap (i, j);
+							ret.swapRows (i, j);
 							if (hasInverse) {
-								inverse = inverse.rowSwap (i, j);
+								inverse.swapRows (i, j);
 							}
 							swapCount++;
 							break;
@@ -483,9 +742,9 @@ namespace Matrix {
 					for (j = i + 1; j < ret.width; j++) {
 						b = ret (i, j);
 						if (!isEqual (b, zero)) {
-							ret = ret.colSwap (i, j);
+							ret.swapColumns (i, j);
 							if (hasInverse) {
-								inverse = inverse.colSwap (i, j);
+								inverse.swapColumns (i, j);
 							}
 						}
 					}
@@ -496,24 +755,24 @@ namespace Matrix {
 					for (j = i + 1; j < ret.height; j++) {
 						b = ret (j, i);
 						if (!isEqual (b, zero)) {
-							ret = ret.rowAddMultiply (j, i, -b / a);
+							ret.addRowMultiple (j, i, -b / a);
 							if (hasInverse) {
-								inverse = inverse.rowAddMultiply (j, i, -b / a);
+								inverse.addRowMultiple (j, i, -b / a);
 							}
 						}
 					}
 					// if we want canonical form, eliminate above diagonal
 					if (canonical) {
-						ret = ret.rowMultiply (i, one / a);
+						ret.addRowMultiple (i, i, one / a - one);
 						if (hasInverse) {
-							inverse = inverse.rowMultiply (i, one / a);
+							inverse.addRowMultiple (i, i, one / a - one);
 						}
 						for (j = 0; j < i; j++) {
 							b = ret (j, i);
 							if (!isEqual (b, zero)) {
-								ret = ret.rowAddMultiply (j, i, -b);
+								ret.addRowMultiple (j, i, -b);
 								if (hasInverse) {
-									inverse = inverse.rowAddMultiply (j, i, -b);
+									inverse.addRowMultiple (j, i, -b);
 								}
 							}
 						}
@@ -528,15 +787,7 @@ namespace Matrix {
 		 * @return rank of the matrix
 		 **/
 		int rank() const {
-			auto triangled = gaussianElimination();
-			int ret = std::min (width, height);
-			int size = ret;
-			for (int i = 0; i < size; i++) {
-				if (isEqual (triangled (i, i), zero)) {
-					ret--;
-				}
-			}
-			return ret;
+			return lu().rank();
 		}
 
 		/* static functions **/
@@ -649,16 +900,43 @@ namespace Matrix {
 			return *this;
 		}
 
+		/**
+		 * move assignment - takes over the storage of m
+		 * (copies if m comes from another resource)
+		 **/
+		Matrix &operator= (Matrix &&m) {
+			if (this != &m) {
+				steal (m);
+			}
+			return *this;
+		}
+
+		/**
+		 * expression assignment - evaluated in a single pass
+		 * (into a temporary only when the size changes)
+		 **/
+		template<class E> Matrix &operator= (const Expression<E, T> &e) {
+			const E &x = e.derived();
+			if (x.getHeight() != height || x.getWidth() != width) {
+				Matrix<T> ret (e);
+				steal (ret);
+			} else {
+				evaluate (x);
+			}
+			return *this;
+		}
+
 		/**
 		 * matrix +=
 		 **/
-		Matrix &operator+= (const Matrix &m) {
-			if (getWidth() != m.getWidth() || getHeight() != m.getHeight()) {
+		template<class E> Matrix &operator+= (const Expression<E, T> &e) {
+			const E &x = e.derived();
+			if (getWidth() != x.getWidth() || getHeight() != x.getHeight()) {
 				throw SizeMismatch();
 			}
 			for (int i = 0; i < getHeight(); i++) {
 				for (int j = 0; j < getWidth(); j++) {
-					at (i, j) += m (i, j);
+					matrix[i][j] += x.get (i, j);
 				}
 			}
 			return *this;
@@ -667,8 +945,16 @@ namespace Matrix {
 		/**
 		 * matrix -=
 		 **/
-		Matrix &operator-= (const Matrix &m) {
-			*this += -m;
+		template<class E> Matrix &operator-= (const Expression<E, T> &e) {
+			const E &x = e.derived();
+			if (getWidth() != x.getWidth() || getHeight() != x.getHeight()) {
+				throw SizeMismatch();
+			}
+			for (int i = 0; i < getHeight(); i++) {
+				for (int j = 0; j < getWidth(); j++) {
+					matrix[i][j] -= x.get (i, j);
+				}
+			}
 			return *this;
 		}
 
@@ -690,51 +976,206 @@ namespace Matrix {
 		 * @param m the matrix to multiply with
 		 * @return this*m
 		 **/
-		Matrix &operator*= (const Matrix &m) {
-			*this = *this * m;
+		template<class E> Matrix &operator*= (const Expression<E, T> &m) {
+			*this = *this * m.derived();
 			return *this;
 		}
+	};
 
-		/**
-		 * returns the negative of the matrix
-		 * @return -matrix
-		 **/
-		Matrix operator-() const {
-			Matrix<T> ret (height, width);
-			for (int i = 0; i < height; i++) {
-				for (int j = 0; j < width; j++) {
-					ret (i, j) = -at (i, j);
-				}
+	/* expression nodes **/
+
+	/**
+	 * true if E (possibly a reference) is a matrix expression
+	 **/
+	template<class E> struct IsExpression : std::is_base_of<ExpressionBase, typename std::decay<E>::type> {};
+
+	/**
+	 * true if E (possibly a reference) is a FixedMatrix - fixed matrices have their own
+	 * eager (unrolled) operators among themselves, see fixedmatrix.h
+	 **/
+	template<class E> struct IsFixedMatrix : std::false_type {};
+	template<class T, int R, int C> struct IsFixedMatrix<FixedMatrix<T, R, C>> : std::true_type {};
+	template<class E> struct IsFixed : IsFixedMatrix<typename std::decay<E>::type> {};
+
+	/**
+	 * the element type of an expression (SFINAE friendly - empty for non-expressions)
+	 **/
+	template<class E, bool = IsExpression<E>::value> struct ValueType {};
+	template<class E> struct ValueType<E, true> {
+		typedef typename std::decay<E>::type::value_type type;
+	};
+
+	/**
+	 * how an operand is held by an expression node:
+	 * named matrices by reference, temporaries and sub-expressions by value
+	 * (so a temporary matrix such as a * b lives as long as the expression)
+	 **/
+	template<class E> struct Operand {
+		typedef typename std::decay<E>::type type;
+	};
+	template<class T> struct Operand<Matrix<T> &> {
+		typedef const Matrix<T> &type;
+	};
+	template<class T> struct Operand<const Matrix<T> &> {
+		typedef const Matrix<T> &type;
+	};
+
+	/* elementwise operations **/
+	struct Plus {
+		template<class T> static constexpr T apply (const T &a, const T &b) {
+			return a + b;
+		}
+	};
+
+	struct Minus {
+		template<class T> static constexpr T apply (const T &a, const T &b) {
+			return a - b;
+		}
+	};
+
+	struct ReverseMinus {
+		template<class T> static constexpr T apply (const T &a, const T &b) {
+			return b - a;
+		}
+	};
+
+	struct Times {
+		template<class T> static constexpr T apply (const T &a, const T &b) {
+			return a * b;
+		}
+	};
+
+	/**
+	 * elementwise operation of two same-sized expressions
+	 **/
+	template<class Op, class L, class R> class BinaryExpression
+		: public Expression<BinaryExpression<Op, L, R>, typename std::decay<L>::type::value_type> {
+		L l;
+		R r;
+	public:
+		typedef typename std::decay<L>::type::value_type value_type;
+		static_assert (std::is_same<value_type, typename std::decay<R>::type::value_type>::value,
+		               "matrix expression element types differ");
+
+		template<class A, class B> BinaryExpression (A &&a, B &&b) : l (std::forward<A> (a)), r (std::forward<B> (b)) {
+			if (l.getWidth() != r.getWidth() || l.getHeight() != r.getHeight()) {
+				throw SizeMismatch();
 			}
-			return ret;
+		}
+
+		int getHeight() const {
+			return l.getHeight();
+		}
+
+		int getWidth() const {
+			return l.getWidth();
+		}
+
+		value_type get (const int row, const int col) const {
+			return Op::apply (l.get (row, col), r.get (row, col));
+		}
+	};
+
+	/**
+	 * elementwise operation of an expression and a scalar
+	 **/
+	template<class Op, class E> class ScalarExpression
+		: public Expression<ScalarExpression<Op, E>, typename std::decay<E>::type::value_type> {
+	public:
+		typedef typename std::decay<E>::type::value_type value_type;
+	private:
+		E e;
+		value_type s;
+	public:
+		template<class A> ScalarExpression (A &&a, const value_type &s) : e (std::forward<A> (a)), s (s) {}
+
+		int getHeight() const {
+			return e.getHeight();
+		}
+
+		int getWidth() const {
+			return e.getWidth();
+		}
+
+		value_type get (const int row, const int col) const {
+			return Op::apply (e.get (row, col), s);
 		}
 	};
 
+	/**
+	 * elementwise negation of an expression
+	 **/
+	template<class E> class NegateExpression
+		: public Expression<NegateExpression<E>, typename std::decay<E>::type::value_type> {
+		E e;
+	public:
+		typedef typename std::decay<E>::type::value_type value_type;
+
+		template<class A> explicit NegateExpression (A &&a) : e (std::forward<A> (a)) {}
+
+		int getHeight() const {
+			return e.getHeight();
+		}
+
+		int getWidth() const {
+			return e.getWidth();
+		}
+
+		value_type get (const int row, const int col) const {
+			return -e.get (row, col);
+		}
+	};
+
+	template<class Op, class L, class R> struct BinaryResult
+		: std::enable_if<IsExpression<L>::value && IsExpression<R>::value && ! (IsFixed<L>::value && IsFixed<R>::value),
+		  BinaryExpression<Op, typename Operand<L>::type, typename Operand<R>::type>> {};
+
+	template<class Op, class E> struct ScalarResult
+		: std::enable_if<IsExpression<E>::value && !IsFixed<E>::value, ScalarExpression<Op, typename Operand<E>::type>> {};
+
+	/**
+	 * an expression as a matrix - named matrices are used as-is, anything else is evaluated
+	 **/
+	template<class T> const Matrix<T> &evaluated (const Matrix<T> &m) {
+		return m;
+	}
+
+	template<class E, class T> Matrix<T> evaluated (const Expression<E, T> &e) {
+		return e.eval();
+	}
+
 	/* class stuff prototypes **/
 
 	/**
-	 * matrix substraction
+	 * matrix substraction (lazy)
 	 * @param m1 matrix 1
 	 * @param m2 matrix 2
 	 * @return m1-m2
 	 **/
-	template<class T> Matrix<T> operator- (const Matrix<T> &, const Matrix<T> &);
+	template<class L, class R> typename BinaryResult<Minus, L, R>::type operator- (L &&, R &&);
 
 	/**
-	 * matrix-scalar substraction
+	 * matrix-scalar substraction (lazy)
 	 * @param m the matrix
 	 * @param s the scalar
-	 * @return m-sI
+	 * @return m with s substracted from each entry
 	 **/
-	template<class T> Matrix<T> operator- (const Matrix<T> &, const T &);
+	template<class E> typename ScalarResult<Minus, E>::type operator- (E &&, const typename ValueType<E>::type &);
 
 	/**
-	 * scalar-matrix substraction
+	 * scalar-matrix substraction (lazy)
 	 * @param s the scalar
 	 * @param m the matrix
-	 * @return sI-m
+	 * @return s minus each entry of m
+	 **/
+	template<class E> typename ScalarResult<ReverseMinus, E>::type operator- (const typename ValueType<E>::type &, E &&);
+
+	/**
+	 * matrix negation (lazy)
+	 * @param m the matrix
+	 * @return -m
 	 **/
-	template<class T> Matrix<T> operator- (const T &, const Matrix<T> &);
+	template<class E> typename std::enable_if<IsExpression<E>::value && !IsFixed<E>::value, NegateExpression<typename Operand<E>::type>>::type operator- (E &&);
 
 	/**
 	 * matrix-scalar comparison
@@ -779,31 +1220,31 @@ namespace Matrix {
 	template<class T> ostream &operator<< (ostream &, const Matrix<T> &);
 
 	/**
-	 * outputs a matrix
+	 * outputs a matrix expression
 	 * @param fd the output stream
-	 * @param m the matrix to print
+	 * @param e the expression to print
 	 * @return reference to fd
 	 **/
-	template<class T> ostream &operator<< (ostream &, const Matrix<T> &);
+	template<class E, class T> ostream &operator<< (ostream &, const Expression<E, T> &);
 
 	/**
-	 * matrix-scalar multiplication
-	 * @param s the scalar
+	 * matrix-scalar multiplication (lazy)
 	 * @param m the matrix
-	 * @return m*sI
+	 * @param s the scalar
+	 * @return m with each entry multiplied by s
 	 **/
-	template<class T> Matrix<T> &operator* (const Matrix<T> &, const T &);
+	template<class E> typename ScalarResult<Times, E>::type operator* (E &&, const typename ValueType<E>::type &);
 
 	/**
-	 * matrix-scalar multiplication
-	 * @param m the matrix
+	 * scalar-matrix multiplication (lazy)
 	 * @param s the scalar
-	 * @return sI*m
+	 * @param m the matrix
+	 * @return m with each entry multiplied by s
 	 **/
-	template<class T> Matrix<T> &operator* (const T &, const Matrix<T> &);
+	template<class E> typename ScalarResult<Times, E>::type operator* (const typename ValueType<E>::type &, E &&);
 
 	/**
-	 * matrix multiplication
+	 * matrix multiplication (cache-blocked, see Gemm)
 	 * @param m1 matrix 1
 	 * @param m2 matrix 2
 	 * @return the multiplication of the two matrices
@@ -811,41 +1252,59 @@ namespace Matrix {
 	template<class T> Matrix<T> operator* (const Matrix<T> &, const Matrix<T> &);
 
 	/**
-	 * matrix addition
+	 * textbook matrix multiplication, kept as the reference for operator*
+	 * @param m1 matrix 1
+	 * @param m2 matrix 2
+	 * @return the multiplication of the two matrices
+	 **/
+	template<class T> Matrix<T> naiveMultiply (const Matrix<T> &, const Matrix<T> &);
+
+	/**
+	 * matrix expression multiplication - evaluates the operands first
+	 * @param m1 expression 1
+	 * @param m2 expression 2
+	 * @return the multiplication of the two expressions
+	 **/
+	template<class L, class R, class T> Matrix<T> operator* (const Expression<L, T> &, const Expression<R, T> &);
+
+	/**
+	 * matrix addition (lazy)
 	 * @param m1 matrix 1
 	 * @param m2 matrix 2
 	 * @return m1+m2
 	 **/
-	template<class T> Matrix<T> operator+ (const Matrix<T> &, const Matrix<T> &);
+	template<class L, class R> typename BinaryResult<Plus, L, R>::type operator+ (L &&, R &&);
 
 	/**
-	 * scalar matrix addition
+	 * scalar matrix addition (lazy)
 	 * @param m matrix
 	 * @param s scalar
-	 * @return m+sI
+	 * @return m with s added to each entry
 	 **/
-	template<class T> Matrix<T> operator+ (const Matrix<T> &, const T &);
+	template<class E> typename ScalarResult<Plus, E>::type operator+ (E &&, const typename ValueType<E>::type &);
 
 	/**
-	 * scalar matrix addition
+	 * scalar matrix addition (lazy)
 	 * @param s scalar
 	 * @param m matrix
-	 * @return sI+m
+	 * @return m with s added to each entry
 	 **/
-	template<class T> Matrix<T> operator+ (const T &, const Matrix<T> &);
+	template<class E> typename ScalarResult<Plus, E>::type operator+ (const typename ValueType<E>::type &, E &&);
 
-	template<class T> Matrix<T> operator- (const Matrix<T> &m1, const Matrix<T> &m2) {
-		Matrix<T> ret = m1;
-		ret -= m2;
-		return ret;
+	template<class L, class R> typename BinaryResult<Minus, L, R>::type operator- (L &&m1, R &&m2) {
+		return typename BinaryResult<Minus, L, R>::type (std::forward<L> (m1), std::forward<R> (m2));
+	}
+
+	template<class E> typename ScalarResult<Minus, E>::type operator- (E &&m, const typename ValueType<E>::type &s) {
+		return typename ScalarResult<Minus, E>::type (std::forward<E> (m), s);
 	}
 
-	template<class T> Matrix<T> operator- (const Matrix<T> &m, const T &s) {
-		return m + (-Matrix<T>::fullMatrix (m.getHeight(), m.getWidth(), s));
+	template<class E> typename ScalarResult<ReverseMinus, E>::type operator- (const typename ValueType<E>::type &s, E &&m) {
+		return typename ScalarResult<ReverseMinus, E>::type (std::forward<E> (m), s);
 	}
 
-	template<class T> Matrix<T> operator- (const T &s, const Matrix<T> &m) {
-		return -m + s;
+	template<class E> typename std::enable_if<IsExpression<E>::value && !IsFixed<E>::value, NegateExpression<typename Operand<E>::type>>::type operator- (E &&m) {
+		return NegateExpression<typename Operand<E>::type> (std::forward<E> (m));
 	}
 
 	template<class T> bool operator== (const Matrix<T> &m, const T &s) {
@@ -874,17 +1333,30 @@ namespace Matrix {
 		return fd;
 	}
 
-	template<class T> Matrix<T> &operator* (const Matrix<T> &m, const T &s) {
-		Matrix<T> ret = m;
-		return ret *= s;
+	template<class E, class T> ostream &operator<< (ostream &fd, const Expression<E, T> &e) {
+		return fd << evaluated (e.derived());
+	}
+
+	template<class E> typename ScalarResult<Times, E>::type operator* (E &&m, const typename ValueType<E>::type &s) {
+		return typename ScalarResult<Times, E>::type (std::forward<E> (m), s);
 	}
 
-	template<class T> Matrix<T> &operator* (const T &s, const Matrix<T> &m) {
-		Matrix<T> ret = m;
-		return ret *= s;
+	template<class E> typename ScalarResult<Times, E>::type operator* (const typename ValueType<E>::type &s, E &&m) {
+		return typename ScalarResult<Times, E>::type (std::forward<E> (m), s);
 	}
 
 	template<class T> Matrix<T> operator* (const Matrix<T> &m1, const Matrix<T> &m2) {
+		if (m1.getWidth() != m2.getHeight()) {
+			throw SizeMismatch();
+		}
+		Matrix<T> ret (m1.getHeight(), m2.getWidth());
+		if (m1.getWidth() > 0) {
+			Gemm<T>::multiply (m1.getHeight(), m2.getWidth(), m1.getWidth(), m1.matrix, m2.matrix, ret.matrix);
+		}
+		return ret;
+	}
+
+	template<class T> Matrix<T> naiveMultiply (const Matrix<T> &m1, const Matrix<T> &m2) {
 		if (m1.getWidth() != m2.getHeight()) {
 			throw SizeMismatch();
 		}
@@ -903,20 +1375,26 @@ namespace Matrix {
 		return ret;
 	}
 
-	template<class T> Matrix<T> operator+ (const Matrix<T> &m1, const Matrix<T> &m2) {
-		Matrix<T> ret = m1;
-		ret += m2;
-		return ret;
+	template<class L, class R, class T> Matrix<T> operator* (const Expression<L, T> &m1, const Expression<R, T> &m2) {
+		return evaluated (m1.derived()) * evaluated (m2.derived());
+	}
+
+	template<class L, class R> typename BinaryResult<Plus, L, R>::type operator+ (L &&m1, R &&m2) {
+		return typename BinaryResult<Plus, L, R>::type (std::forward<L> (m1), std::forward<R> (m2));
 	}
 
-	template<class T> Matrix<T> operator+ (const Matrix<T> &m, const T &s) {
-		return Matrix<T>::fullMatrix (m.getHeight(), m.getWidth(), s) + m;
+	template<class E> typename ScalarResult<Plus, E>::type operator+ (E &&m, const typename ValueType<E>::type &s) {
+		return typename ScalarResult<Plus, E>::type (std::forward<E> (m), s);
 	}
 
-	template<class T> Matrix<T> operator+ (const T &s, const Matrix<T> &m) {
-		return m + s;
+	template<class E> typename ScalarResult<Plus, E>::type operator+ (const typename ValueType<E>::type &s, E &&m) {
+		return typename ScalarResult<Plus, E>::type (std::forward<E> (m), s);
 	}
 
 }
 
+#include "fixedmatrix.h"
+#include "matrixview.h"
+#include "sparsematrix.h"
+
 #endif
@@ -0,0 +1,68 @@
+#ifndef _MATRIXVIEW_H
+#define _MATRIXVIEW_H
+
+#include "exceptions.h"
+#include "matrix.h"
+
+namespace Matrix {
+	/**
+	 * a read-only window into the storage of a Matrix: a row, a column,
+	 * a (strided) submatrix or a minor. nothing is copied until the view is
+	 * evaluated - a view is a matrix expression, so it can be assigned to a Matrix,
+	 * mixed with matrices in +, - and *, or materialized with eval().
+	 * the view reads the parent's row pointers, so it sees later writes to the parent
+	 * and follows its row swaps, but it must not outlive it (or a resize of it).
+	 * element (i, j) of the view is the parent's element
+	 * (top + (i + (i >= skipRow)) * rowStep, left + (j + (j >= skipColumn)) * columnStep)
+	 **/
+	template<class T> class MatrixView : public Expression<MatrixView<T>, T> {
+		template<class, class, class> friend class BinaryExpression;
+		template<class, class> friend class ScalarExpression;
+		template<class> friend class NegateExpression;
+		template<class> friend class Matrix;
+		template<class, int, int> friend class FixedMatrix;
+
+		const T *const *rows;
+		int top, left;
+		int height, width;
+		int rowStep, columnStep;
+		// the parent row/column left out (a minor), height/width if none
+		int skipRow, skipColumn;
+
+		MatrixView (const T *const *rows, const int top, const int left, const int height, const int width,
+		            const int rowStep, const int columnStep, const int skipRow, const int skipColumn) :
+			rows (rows), top (top), left (left), height (height), width (width), rowStep (rowStep),
+			columnStep (columnStep), skipRow (skipRow), skipColumn (skipColumn) {
+		}
+
+		/**
+		 * unchecked element access, used by expression evaluation
+		 **/
+		const T &get (const int row, const int col) const {
+			return rows[top + (row + (row >= skipRow)) * rowStep][left + (col + (col >= skipColumn)) * columnStep];
+		}
+	public:
+		int getHeight() const {
+			return height;
+		}
+
+		int getWidth() const {
+			return width;
+		}
+
+		/**
+		 * gets the value at (i,j) of the view
+		 * @param row row
+		 * @param col column
+		 * @return the value at (i,j)
+		 **/
+		const T &operator() (const int row, const int col) const {
+			if (row < 0 || row >= height || col < 0 || col >= width) {
+				throw OutOfBounds();
+			}
+			return get (row, col);
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef _PAGES_H
+#define _PAGES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "arena.h"
+
+namespace Matrix {
+	/**
+	 * whole pages straight from mmap, optionally huge (2 MB) ones:
+	 * TRANSPARENT asks the kernel to back the (2 MB aligned) range with transparent huge pages,
+	 * EXPLICIT takes them from the reserved hugetlbfs pool (falling back to TRANSPARENT if it is empty).
+	 * the pages come back zero-filled and untouched, so the thread that first writes a page
+	 * decides which NUMA node it lives on (first touch).
+	 **/
+	class PageResource : public MemoryResource {
+	public:
+		enum HugePages { NONE, TRANSPARENT, EXPLICIT };
+	private:
+		static const size_t HUGE_PAGE = 2 << 20;
+
+		HugePages huge;
+
+		size_t rounded (const size_t bytes) const {
+			const size_t page = huge == NONE ? size_t (sysconf (_SC_PAGESIZE)) : HUGE_PAGE;
+			return (bytes + page - 1) / page * page;
+		}
+
+		static void *map (const size_t bytes, const int flags) {
+			void *p = mmap (nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+			return p == MAP_FAILED ? nullptr : p;
+		}
+	public:
+		explicit PageResource (const HugePages huge = NONE) : huge (huge) {
+		}
+
+		void *allocate (const size_t bytes, const size_t) override {
+			const size_t size = rounded (bytes);
+			void *p = nullptr;
+#ifdef MAP_HUGETLB
+			if (huge == EXPLICIT) {
+				p = map (size, MAP_HUGETLB);
+			}
+#endif
+			if (p == nullptr && huge != NONE) {
+				// over-allocate, and trim to a huge page boundary
+				char *raw = static_cast<char *> (map (size + HUGE_PAGE, 0));
+				if (raw != nullptr) {
+					char *aligned = raw + (HUGE_PAGE - reinterpret_cast<uintptr_t> (raw) % HUGE_PAGE) % HUGE_PAGE;
+					if (aligned != raw) {
+						munmap (raw, aligned - raw);
+					}
+					munmap (aligned + size, raw + HUGE_PAGE - aligned);
+					p = aligned;
+#ifdef MADV_HUGEPAGE
+					madvise (p, size, MADV_HUGEPAGE);
+#endif
+				}
+			}
+			if (p == nullptr && huge == NONE) {
+				p = map (size, 0);
+			}
+			if (p == nullptr) {
+				throw std::bad_alloc();
+			}
+			return p;
+		}
+
+		void deallocate (void *p, const size_t bytes, const size_t) override {
+			munmap (p, rounded (bytes));
+		}
+
+		bool zeroes() const override {
+			return true;
+		}
+
+		HugePages getHugePages() const {
+			return huge;
+		}
+
+		/**
+		 * returns the shared resource of a kind
+		 * @param huge the kind of pages
+		 * @return the resource
+		 **/
+		static PageResource *get (const HugePages huge) {
+			static PageResource resources[] = { PageResource (NONE), PageResource (TRANSPARENT), PageResource (EXPLICIT) };
+			return &resources[huge];
+		}
+
+		/**
+		 * returns the NUMA node of the page holding an address
+		 * (the page is faulted in if it wasn't touched yet)
+		 * @param p the address
+		 * @return the node, -1 if unknown
+		 **/
+		static int nodeOf (const void *p) {
+#ifdef SYS_get_mempolicy
+			// MPOL_F_NODE | MPOL_F_ADDR of <numaif.h>
+			const unsigned long flags = 1 | 2;
+			int node = -1;
+			if (syscall (SYS_get_mempolicy, &node, nullptr, 0UL, const_cast<void *> (p), flags) == 0) {
+				return node;
+			}
+#endif
+			(void) p;
+			return -1;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,516 @@
+#ifndef _SPARSEMATRIX_H
+#define _SPARSEMATRIX_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "exceptions.h"
+#include "gemm.h"
+#include "matrix.h"
+
+namespace Matrix {
+	/**
+	 * a sparse matrix in compressed sparse row (CSR) or column (CSC) form:
+	 * only the non-zero entries are stored, so memory and the cost of the
+	 * products grow with the number of non-zeros rather than with height*width.
+	 * a row (CSR) or column (CSC) is the "major" dimension, the other the "minor" one.
+	 * products with a vector, a dense Matrix or another sparse matrix use up to
+	 * multiplyThreads() threads (see gemm.h), splitting the work into bands with
+	 * about as many non-zeros each.
+	 **/
+	template<class T> class SparseMatrix {
+	public:
+		enum Format { CSR, CSC };
+
+		/**
+		 * a single (row, col, value) entry, used to build a sparse matrix
+		 **/
+		struct Entry {
+			int row, col;
+			T value;
+		};
+	private:
+		int height, width;
+		Format format;
+		// the entries of major line k are [offsets[k], offsets[k + 1])
+		std::vector<int> offsets;
+		// the minor index of each entry, ascending within a major line
+		std::vector<int> indices;
+		std::vector<T> values;
+
+		// below this many multiply-adds a single thread is used
+		static const long parallelWork = 1L << 16;
+
+		int majorSize() const {
+			return format == CSR ? height : width;
+		}
+
+		int minorSize() const {
+			return format == CSR ? width : height;
+		}
+
+		static int threadsFor (const long work) {
+			return work < parallelWork ? 1 : std::max (1, multiplyThreads());
+		}
+
+		/**
+		 * splits the major lines into at most n bands with about as many entries each
+		 * @return the band boundaries (first line of each band, then majorSize())
+		 **/
+		std::vector<int> bands (const int n) const {
+			const int major = majorSize();
+			const long count = values.size();
+			std::vector<int> bounds (1, 0);
+			for (int k = 1; k < n; k++) {
+				int b = std::lower_bound (offsets.begin(), offsets.end(), count * k / n) - offsets.begin();
+				if (b > bounds.back() && b < major) {
+					bounds.push_back (b);
+				}
+			}
+			if (bounds.back() != major) {
+				bounds.push_back (major);
+			}
+			return bounds;
+		}
+
+		/**
+		 * splits [0, size) into at most n even bands
+		 **/
+		static std::vector<int> evenBands (const int size, const int n) {
+			std::vector<int> bounds (1, 0);
+			const int parts = std::max (1, std::min (n, size));
+			for (int k = 1; k <= parts; k++) {
+				bounds.push_back (int (long (size) * k / parts));
+			}
+			return bounds;
+		}
+
+		/**
+		 * runs f (begin, end) for each band, the first on the calling thread
+		 **/
+		template<class F> static void inBands (const std::vector<int> &bounds, const F &f) {
+			std::vector<std::thread> workers;
+			for (size_t k = 1; k + 1 < bounds.size(); k++) {
+				workers.push_back (std::thread (f, bounds[k], bounds[k + 1]));
+			}
+			if (bounds.size() > 1) {
+				f (bounds[0], bounds[1]);
+			}
+			for (auto &w : workers) {
+				w.join();
+			}
+		}
+
+		/**
+		 * builds the offsets from the number of entries of each major line
+		 **/
+		void countsToOffsets() {
+			int sum = 0;
+			for (auto &o : offsets) {
+				int count = o;
+				o = sum;
+				sum += count;
+			}
+		}
+
+		/**
+		 * y = A x for CSR, one dot product per row
+		 **/
+		void multiplyRows (const int r0, const int r1, const T *x, T *y) const {
+			for (int i = r0; i < r1; i++) {
+				T sum = T (0);
+				for (int e = offsets[i]; e < offsets[i + 1]; e++) {
+					sum += values[e] * x[indices[e]];
+				}
+				y[i] = sum;
+			}
+		}
+
+		/**
+		 * y += A[:, c0:c1] x[c0:c1] for CSC, scattering each column
+		 **/
+		void scatterColumns (const int c0, const int c1, const T *x, T *y) const {
+			for (int j = c0; j < c1; j++) {
+				const T xj = x[j];
+				for (int e = offsets[j]; e < offsets[j + 1]; e++) {
+					y[indices[e]] += values[e] * xj;
+				}
+			}
+		}
+
+		SparseMatrix (const int height, const int width, const Format format, const int reserve) :
+			SparseMatrix (height, width, format) {
+			indices.reserve (reserve);
+			values.reserve (reserve);
+		}
+	public:
+		/**
+		 * creates an all-zero h*w sparse matrix
+		 * @param height
+		 * @param width
+		 * @param format CSR or CSC
+		 **/
+		SparseMatrix (const int height, const int width, const Format format = CSR) : height (height),
+			width (width), format (format) {
+			if (height < 0 || width < 0) {
+				throw InvalidSize();
+			}
+			offsets.assign (majorSize() + 1, 0);
+		}
+
+		/**
+		 * builds a sparse matrix from a list of entries (in any order)
+		 * duplicate entries are summed, zeros are dropped
+		 * @param height
+		 * @param width
+		 * @param entries the entries
+		 * @param format CSR or CSC
+		 **/
+		SparseMatrix (const int height, const int width, std::vector<Entry> entries, const Format format = CSR) :
+			SparseMatrix (height, width, format) {
+			for (const Entry &entry : entries) {
+				if (entry.row < 0 || entry.row >= height || entry.col < 0 || entry.col >= width) {
+					throw OutOfBounds();
+				}
+			}
+			const bool rows = format == CSR;
+			std::sort (entries.begin(), entries.end(), [rows] (const Entry & a, const Entry & b) {
+				return rows ? (a.row != b.row ? a.row < b.row : a.col < b.col) : (a.col != b.col ? a.col < b.col : a.row < b.row);
+			});
+			indices.reserve (entries.size());
+			values.reserve (entries.size());
+			for (size_t k = 0; k < entries.size();) {
+				const int major = rows ? entries[k].row : entries[k].col;
+				const int minor = rows ? entries[k].col : entries[k].row;
+				T sum = entries[k].value;
+				for (k++; k < entries.size() && entries[k].row == entries[k - 1].row && entries[k].col == entries[k - 1].col; k++) {
+					sum += entries[k].value;
+				}
+				if (sum != T (0)) {
+					offsets[major]++;
+					indices.push_back (minor);
+					values.push_back (sum);
+				}
+			}
+			countsToOffsets();
+		}
+
+		/**
+		 * takes the non-zero entries of a dense matrix
+		 * @param m the dense matrix
+		 * @param format CSR or CSC
+		 **/
+		explicit SparseMatrix (const Matrix<T> &m, const Format format = CSR) :
+			SparseMatrix (m.getHeight(), m.getWidth(), format) {
+			const int major = majorSize(), minor = minorSize();
+			long count = 0;
+			for (int i = 0; i < height; i++) {
+				const T *row = m.matrix[i];
+				for (int j = 0; j < width; j++) {
+					count += row[j] != T (0);
+				}
+			}
+			indices.reserve (count);
+			values.reserve (count);
+			for (int k = 0; k < major; k++) {
+				for (int l = 0; l < minor; l++) {
+					const T &value = format == CSR ? m.matrix[k][l] : m.matrix[l][k];
+					if (value != T (0)) {
+						indices.push_back (l);
+						values.push_back (value);
+					}
+				}
+				offsets[k + 1] = values.size();
+			}
+		}
+
+		int getHeight() const {
+			return height;
+		}
+
+		int getWidth() const {
+			return width;
+		}
+
+		Format getFormat() const {
+			return format;
+		}
+
+		/**
+		 * returns the number of stored (non-zero) entries
+		 * @return the number of non-zeros
+		 **/
+		long getNonZeros() const {
+			return values.size();
+		}
+
+		/**
+		 * the raw compressed arrays: offsets of each major line, minor index and value of each entry
+		 **/
+		const std::vector<int> &getOffsets() const {
+			return offsets;
+		}
+
+		const std::vector<int> &getIndices() const {
+			return indices;
+		}
+
+		const std::vector<T> &getValues() const {
+			return values;
+		}
+
+		/**
+		 * gets the value at (i,j) - a binary search within the row (CSR) or column (CSC)
+		 * @param row row
+		 * @param col column
+		 * @return the value at (i,j)
+		 **/
+		T operator() (const int row, const int col) const {
+			if (row < 0 || row >= height || col < 0 || col >= width) {
+				throw OutOfBounds();
+			}
+			const int major = format == CSR ? row : col;
+			const int minor = format == CSR ? col : row;
+			auto begin = indices.begin() + offsets[major], end = indices.begin() + offsets[major + 1];
+			auto found = std::lower_bound (begin, end, minor);
+			return found != end && *found == minor ? values[found - indices.begin()] : T (0);
+		}
+
+		/**
+		 * returns the same matrix in the given format (a counting sort, linear in the non-zeros)
+		 * @param target CSR or CSC
+		 * @return the converted matrix
+		 **/
+		SparseMatrix convert (const Format target) const {
+			if (target == format) {
+				return *this;
+			}
+			SparseMatrix ret (height, width, target, values.size());
+			ret.indices.resize (values.size());
+			ret.values.resize (values.size());
+			for (int index : indices) {
+				ret.offsets[index]++;
+			}
+			ret.countsToOffsets();
+			std::vector<int> next (ret.offsets.begin(), ret.offsets.end() - 1);
+			for (int k = 0; k < majorSize(); k++) {
+				for (int e = offsets[k]; e < offsets[k + 1]; e++) {
+					const int position = next[indices[e]]++;
+					ret.indices[position] = k;
+					ret.values[position] = values[e];
+				}
+			}
+			return ret;
+		}
+
+		/**
+		 * returns the transposed matrix, in the same format
+		 * (linear in the non-zeros: the CSR arrays of A are the CSC arrays of A^T)
+		 * @return the transposed matrix
+		 **/
+		SparseMatrix transpose() const {
+			SparseMatrix swapped (width, height, format == CSR ? CSC : CSR);
+			swapped.offsets = offsets;
+			swapped.indices = indices;
+			swapped.values = values;
+			return swapped.convert (format);
+		}
+
+		/**
+		 * returns the matrix as a dense Matrix
+		 * @return the dense matrix
+		 **/
+		Matrix<T> toMatrix() const {
+			Matrix<T> ret (height, width);
+			for (int k = 0; k < majorSize(); k++) {
+				for (int e = offsets[k]; e < offsets[k + 1]; e++) {
+					if (format == CSR) {
+						ret.matrix[k][indices[e]] = values[e];
+					} else {
+						ret.matrix[indices[e]][k] = values[e];
+					}
+				}
+			}
+			return ret;
+		}
+
+		/**
+		 * sparse matrix-vector product
+		 * @param x the vector (width entries)
+		 * @return A x (height entries)
+		 **/
+		std::vector<T> multiply (const std::vector<T> &x) const {
+			if (long (x.size()) != width) {
+				throw SizeMismatch();
+			}
+			std::vector<T> y (height, T (0));
+			const int threads = threadsFor (values.size());
+			if (format == CSR) {
+				inBands (bands (threads), [&] (const int r0, const int r1) {
+					multiplyRows (r0, r1, x.data(), y.data());
+				});
+				return y;
+			}
+			// CSC scatters into y - each band gets its own partial sum
+			std::vector<int> bounds = bands (threads);
+			std::vector<std::vector<T>> partial (bounds.size() > 2 ? bounds.size() - 2 : 0, std::vector<T> (height, T (0)));
+			inBands (bounds, [&] (const int c0, const int c1) {
+				const size_t band = std::lower_bound (bounds.begin(), bounds.end(), c0) - bounds.begin();
+				scatterColumns (c0, c1, x.data(), band == 0 ? y.data() : partial[band - 1].data());
+			});
+			for (const auto &p : partial) {
+				for (int i = 0; i < height; i++) {
+					y[i] += p[i];
+				}
+			}
+			return y;
+		}
+
+		/**
+		 * sparse * dense matrix product
+		 * CSR splits the rows of the result between the threads, CSC its columns
+		 * @param b the dense matrix (width rows)
+		 * @return A b as a dense matrix
+		 **/
+		Matrix<T> multiply (const Matrix<T> &b) const {
+			if (b.getHeight() != width) {
+				throw SizeMismatch();
+			}
+			const int k = b.getWidth();
+			Matrix<T> c (height, k);
+			if (k == 0 || height == 0) {
+				return c;
+			}
+			const int threads = threadsFor (long (values.size()) * k);
+			const T *const *source = b.matrix;
+			T **target = c.matrix;
+			if (format == CSR) {
+				inBands (bands (threads), [&] (const int r0, const int r1) {
+					for (int i = r0; i < r1; i++) {
+						T *row = target[i];
+						for (int e = offsets[i]; e < offsets[i + 1]; e++) {
+							const T value = values[e];
+							const T *other = source[indices[e]];
+							for (int j = 0; j < k; j++) {
+								row[j] += value * other[j];
+							}
+						}
+					}
+				});
+			} else {
+				inBands (evenBands (k, threads), [&] (const int j0, const int j1) {
+					for (int col = 0; col < width; col++) {
+						const T *other = source[col];
+						for (int e = offsets[col]; e < offsets[col + 1]; e++) {
+							const T value = values[e];
+							T *row = target[indices[e]];
+							for (int j = j0; j < j1; j++) {
+								row[j] += value * other[j];
+							}
+						}
+					}
+				});
+			}
+			return c;
+		}
+
+		/**
+		 * sparse * sparse matrix product (row by row, with a dense accumulator per thread)
+		 * CSC operands are converted to CSR first, the result is CSR
+		 * @param b the other sparse matrix (width rows)
+		 * @return A b, without the entries that cancel out
+		 **/
+		SparseMatrix multiply (const SparseMatrix &b) const {
+			if (b.height != width) {
+				throw SizeMismatch();
+			}
+			if (format != CSR || b.format != CSR) {
+				return convert (CSR).multiply (b.convert (CSR));
+			}
+			const int n = b.width;
+			// the work is about the number of entries of b touched, estimated from the entries of this
+			const long work = b.values.empty() ? 0 : long (values.size()) * long (b.values.size()) / std::max (1, b.height);
+			std::vector<int> bounds = bands (threadsFor (work));
+			const size_t parts = bounds.size() > 1 ? bounds.size() - 1 : 0;
+			std::vector<std::vector<int>> partIndices (parts);
+			std::vector<std::vector<T>> partValues (parts);
+			SparseMatrix ret (height, n, CSR);
+			inBands (bounds, [&] (const int r0, const int r1) {
+				const size_t part = std::lower_bound (bounds.begin(), bounds.end(), r0) - bounds.begin();
+				std::vector<T> accumulator (n, T (0));
+				std::vector<int> marker (n, -1);
+				std::vector<int> touched;
+				for (int i = r0; i < r1; i++) {
+					touched.clear();
+					for (int e = offsets[i]; e < offsets[i + 1]; e++) {
+						const int p = indices[e];
+						const T value = values[e];
+						for (int f = b.offsets[p]; f < b.offsets[p + 1]; f++) {
+							const int j = b.indices[f];
+							if (marker[j] != i) {
+								marker[j] = i;
+								accumulator[j] = T (0);
+								touched.push_back (j);
+							}
+							accumulator[j] += value * b.values[f];
+						}
+					}
+					std::sort (touched.begin(), touched.end());
+					int count = 0;
+					for (int j : touched) {
+						if (accumulator[j] != T (0)) {
+							partIndices[part].push_back (j);
+							partValues[part].push_back (accumulator[j]);
+							count++;
+						}
+					}
+					ret.offsets[i] = count;
+				}
+			});
+			ret.countsToOffsets();
+			long total = 0;
+			for (size_t part = 0; part < parts; part++) {
+				total += partValues[part].size();
+			}
+			ret.indices.reserve (total);
+			ret.values.reserve (total);
+			for (size_t part = 0; part < parts; part++) {
+				ret.indices.insert (ret.indices.end(), partIndices[part].begin(), partIndices[part].end());
+				ret.values.insert (ret.values.end(), partValues[part].begin(), partValues[part].end());
+			}
+			return ret;
+		}
+	};
+
+	/**
+	 * sparse matrix-vector product
+	 * @param a the sparse matrix
+	 * @param x the vector
+	 * @return a x
+	 **/
+	template<class T> std::vector<T> operator* (const SparseMatrix<T> &a, const std::vector<T> &x) {
+		return a.multiply (x);
+	}
+
+	/**
+	 * sparse * dense matrix product
+	 * @param a the sparse matrix
+	 * @param b the dense matrix
+	 * @return a b
+	 **/
+	template<class T> Matrix<T> operator* (const SparseMatrix<T> &a, const Matrix<T> &b) {
+		return a.multiply (b);
+	}
+
+	/**
+	 * sparse * sparse matrix product
+	 * @param a sparse matrix 1
+	 * @param b sparse matrix 2
+	 * @return a b
+	 **/
+	template<class T> SparseMatrix<T> operator* (const SparseMatrix<T> &a, const SparseMatrix<T> &b) {
+		return a.multiply (b);
+	}
+}
+
+#endif